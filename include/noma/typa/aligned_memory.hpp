@@ -0,0 +1,143 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_aligned_memory_hpp
+#define noma_typa_aligned_memory_hpp
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring> // memcpy()
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace noma {
+namespace typa {
+
+/**
+ * Default alignment of the storage of vector and matrix in bytes: a cache line, which also suffices
+ * for aligned loads of the widest SIMD registers (AVX-512).
+ */
+const size_t default_alignment = 64;
+
+/**
+ * True if 'alignment' can be passed to allocate_aligned().
+ */
+constexpr bool is_valid_alignment(size_t alignment)
+{
+	return alignment > 0 && (alignment & (alignment - 1)) == 0;
+}
+
+/**
+ * Allocate 'size' bytes aligned to 'alignment', see is_valid_alignment().
+ * Throws std::bad_alloc on failure.
+ */
+void* allocate_aligned(size_t size, size_t alignment);
+
+/**
+ * Release memory obtained from allocate_aligned(), nullptr is ignored.
+ */
+void deallocate_aligned(void* ptr);
+
+/**
+ * Standard conforming allocator for memory aligned to Alignment bytes, the default allocator of
+ * vector and matrix.
+ */
+template<typename T, size_t Alignment = default_alignment>
+struct aligned_allocator
+{
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_move_assignment; // stateless
+
+	template<typename U>
+	struct rebind
+	{
+		typedef aligned_allocator<U, Alignment> other;
+	};
+
+	aligned_allocator() = default;
+
+	template<typename U>
+	aligned_allocator(const aligned_allocator<U, Alignment>&) { }
+
+	T* allocate(size_t count)
+	{
+		if (count > static_cast<size_t>(-1) / sizeof(T))
+			throw std::bad_alloc();
+		return static_cast<T*>(allocate_aligned(count * sizeof(T), Alignment));
+	}
+
+	void deallocate(T* ptr, size_t)
+	{
+		deallocate_aligned(ptr);
+	}
+};
+
+template<typename T, typename U, size_t Alignment>
+bool operator==(const aligned_allocator<T, Alignment>&, const aligned_allocator<U, Alignment>&) { return true; }
+
+template<typename T, typename U, size_t Alignment>
+bool operator!=(const aligned_allocator<T, Alignment>&, const aligned_allocator<U, Alignment>&) { return false; }
+
+/**
+ * Allocate and construct 'count' elements with 'alloc'. Trivial types are left uninitialised, like
+ * with new T[count]. Returns nullptr for 'count' == 0.
+ * NOTE: Allocator::pointer must be a plain pointer.
+ */
+template<typename Allocator>
+typename std::allocator_traits<Allocator>::value_type* allocate_elements(Allocator& alloc, size_t count)
+{
+	typedef std::allocator_traits<Allocator> traits;
+	typedef typename traits::value_type T;
+	if (count == 0)
+		return nullptr;
+	T* data = traits::allocate(alloc, count);
+	if (std::is_trivially_default_constructible<T>::value)
+		return data;
+	size_t i = 0;
+	try {
+		for (; i < count; ++i)
+			traits::construct(alloc, data + i);
+	} catch (...) {
+		while (i > 0)
+			traits::destroy(alloc, data + --i);
+		traits::deallocate(alloc, data, count);
+		throw;
+	}
+	return data;
+}
+
+/**
+ * Destroy and release 'count' elements from allocate_elements(), nullptr is ignored.
+ */
+template<typename Allocator>
+void deallocate_elements(Allocator& alloc, typename std::allocator_traits<Allocator>::value_type* data, size_t count)
+{
+	typedef std::allocator_traits<Allocator> traits;
+	if (!data)
+		return;
+	if (!std::is_trivially_destructible<typename traits::value_type>::value)
+		for (size_t i = 0; i < count; ++i)
+			traits::destroy(alloc, data + i);
+	traits::deallocate(alloc, data, count);
+}
+
+/**
+ * Copy 'count' elements from 'first' to 'out', with a single memcpy() for trivially copyable T.
+ */
+template<typename T>
+void copy_elements(const T* first, size_t count, T* out)
+{
+	if (std::is_trivially_copyable<T>::value) {
+		if (count > 0)
+			std::memcpy(static_cast<void*>(out), first, count * sizeof(T));
+	} else {
+		std::copy(first, first + count, out);
+	}
+}
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_aligned_memory_hpp
@@ -5,10 +5,13 @@
 #ifndef noma_typa_basic_types_hpp
 #define noma_typa_basic_types_hpp
 
+#include <algorithm>
 #include <complex>
 #include <iostream>
 #include <string>
 
+#include "noma/typa/number.hpp"
+#include "noma/typa/parser.hpp"
 #include "noma/typa/util.hpp"
 
 namespace noma {
@@ -33,6 +36,11 @@ struct type_to_regexp<T, typename std::enable_if<std::is_integral<T>::value>::ty
 	static const std::string& exp_str() { return integer_literal(); }
 };
 
+template<class T>
+struct type_to_parser<T, typename std::enable_if<std::is_integral<T>::value>::type> : literal_parser<integer_literal_recogniser>
+{
+};
+
 
 /**
  * Returns a regular expression string for a floating point literal (C++11 modified ECMAScript).
@@ -64,6 +72,11 @@ struct type_to_regexp<T, typename std::enable_if<std::is_floating_point<T>::valu
 	static const std::string& exp_str() { return real_literal(); }
 };
 
+template<typename T>
+struct type_to_parser<T, typename std::enable_if<std::is_floating_point<T>::value>::type> : literal_parser<real_literal_recogniser>
+{
+};
+
 /**
  * Returns a regular expression string for a C++11 complex literal (C++11 modified ECMAScript).
  * NOTE: as a function for definied initalisation order.
@@ -79,6 +92,11 @@ struct type_to_regexp<std::complex<T>>
 	static const std::string& exp_str() { return complex_literal(); }
 };
 
+template<typename T>
+struct type_to_parser<std::complex<T>> : literal_parser<complex_literal_recogniser>
+{
+};
+
 /**
  * Returns a regular expression matching anystring that does not contain any of "{}(),",
  * as those are used for braced lists and pairs.
@@ -91,6 +109,61 @@ struct type_to_regexp<std::string>
 	static const std::string& exp_str() { return string_literal(); }
 };
 
+template<>
+struct type_to_parser<std::string> : literal_parser<string_literal_recogniser>
+{
+};
+
+/**
+ * Specialisation for the arithmetic types supported by number.hpp: convert directly from the
+ * characters, falling back to boost::lexical_cast for anything the fast path does not handle, so
+ * results and errors stay the same.
+ */
+template<typename T>
+struct string_to_value<T, typename std::enable_if<is_fast_number<T>::value>::type>
+{
+	static T parse(const std::string& input)
+	{
+		return parse(input.data(), input.data() + input.size());
+	}
+
+	static T parse(const char* first, const char* last)
+	{
+		T value;
+		if (parse_number(first, last, value))
+			return value;
+		return boost::lexical_cast<T>(first, last - first);
+	}
+};
+
+/**
+ * Specialisation for complex numbers of the above: "(real,real)" or "real".
+ */
+template<typename T>
+struct string_to_value<std::complex<T>, typename std::enable_if<is_fast_number<T>::value && std::is_floating_point<T>::value>::type>
+{
+	static std::complex<T> parse(const std::string& input)
+	{
+		return parse(input.data(), input.data() + input.size());
+	}
+
+	static std::complex<T> parse(const char* first, const char* last)
+	{
+		T re, im = T(0);
+		bool valid;
+		if (first != last && *first == '(') {
+			const char* comma = std::find(first, last, ',');
+			valid = comma != last && *(last - 1) == ')'
+			     && parse_number(first + 1, comma, re) && parse_number(comma + 1, last - 1, im);
+		} else {
+			valid = parse_number(first, last, re);
+		}
+		if (valid)
+			return std::complex<T>(re, im);
+		return boost::lexical_cast<std::complex<T>>(first, last - first);
+	}
+};
+
 // Examples: regular expression objects used for matching
 //const std::regex real_literal_exp { real_literal() };
 //const std::regex complex_literal_exp { complex_literal() };
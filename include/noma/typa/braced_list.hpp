@@ -6,14 +6,18 @@
 #define noma_typa_braced_list_hpp
 
 #include <algorithm>
+#include <exception>
 #include <iostream>
-#include <regex>
 #include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <boost/lexical_cast.hpp>
 
+#include "noma/typa/parallel.hpp"
 #include "noma/typa/parser_error.hpp"
+#include "noma/typa/parser.hpp"
 #include "noma/typa/util.hpp"
 
 namespace noma {
@@ -26,34 +30,269 @@ namespace typa {
  */
 std::string make_braced_list(const std::string& entry_exp);
 
+/**
+ * Number of entries of the braced list in [first, last), counted over its structural characters,
+ * i.e. without parsing the entries. Exact for valid lists, used to presize containers before
+ * parsing.
+ */
+size_t count_list_entries(const char* first, const char* last);
+
+namespace detail {
+
+/**
+ * Part of a braced list parsed by one task of try_parse_braced_list(): 'count' entries separated by
+ * commas, stored into the result starting at 'offset'.
+ */
+struct list_chunk
+{
+	const char* first; // behind the opening '{' or a top-level ','
+	const char* last; // at the closing '}' or a top-level ','
+	size_t offset;
+	size_t count;
+};
+
+/**
+ * Detects parsers derived from literal_parser with a plain recogniser, i.e. entries that never
+ * contain structural characters, so every comma in a valid list separates entries.
+ */
+template<typename Recogniser>
+std::integral_constant<bool, Recogniser::plain> is_plain_parser_test(const literal_parser<Recogniser>*);
+std::false_type is_plain_parser_test(...);
+
+template<typename Parser>
+struct is_plain_parser : decltype(is_plain_parser_test(static_cast<const Parser*>(nullptr)))
+{
+};
+
+inline void add_list_chunk(std::vector<list_chunk>& chunks, const char* first, const char* last, size_t commas)
+{
+	const size_t offset = chunks.empty() ? 0 : chunks.back().offset + chunks.back().count;
+	chunks.push_back({ first, last, offset, commas + 1 });
+}
+
+/**
+ * Split the braced list [first, last), with '{' at first and '}' at last - 1, into about 'n' chunks of
+ * similar size at top-level commas.
+ * Plain entries: cut at the first comma behind every n-th of the input, count the commas in parallel.
+ */
+inline bool split_braced_list(const char* first, const char* last, size_t n, std::vector<list_chunk>& chunks, std::true_type)
+{
+	const char* inner_last = last - 1;
+	const char* chunk_first = first + 1;
+	for (size_t k = 1; k < n; ++k) {
+		const char* nominal = std::max(first + k * ((last - first) / n), chunk_first);
+		const char* cut = std::find(nominal, inner_last, ',');
+		if (cut == inner_last)
+			break;
+		chunks.push_back({ chunk_first, cut, 0, 0 });
+		chunk_first = cut + 1;
+	}
+	chunks.push_back({ chunk_first, inner_last, 0, 0 });
+
+	parallel_for(chunks.size(), [&](size_t i) {
+		chunks[i].count = std::count(chunks[i].first, chunks[i].last, ',') + 1;
+	});
+	for (size_t i = 1; i < chunks.size(); ++i)
+		chunks[i].offset = chunks[i - 1].offset + chunks[i - 1].count;
+	return true;
+}
+
+/**
+ * Nested entries: track the nesting depth over a structural_index, serially. Returns false if the
+ * nesting is malformed, the caller uses the serial parser then, which finds the error.
+ */
+inline bool split_braced_list(const char* first, const char* last, size_t n, std::vector<list_chunk>& chunks, std::false_type)
+{
+	const char* inner_last = last - 1;
+	const size_t chunk_size = (last - first) / n;
+	structural_index index(first + 1, inner_last);
+	const char* chunk_first = first + 1;
+	size_t depth = 0;
+	size_t commas = 0;
+	for (const char* pos = index.next(chunk_first); pos != inner_last; pos = index.next(pos + 1)) {
+		switch (*pos) {
+			case '{': case '(':
+				++depth;
+				break;
+			case '}': case ')':
+				if (depth == 0)
+					return false;
+				--depth;
+				break;
+			default: // ','
+				if (depth > 0)
+					break;
+				if (static_cast<size_t>(pos - chunk_first) >= chunk_size) {
+					add_list_chunk(chunks, chunk_first, pos, commas);
+					chunk_first = pos + 1;
+					commas = 0;
+				} else {
+					++commas;
+				}
+		}
+	}
+	if (depth != 0)
+		return false;
+	add_list_chunk(chunks, chunk_first, inner_last, commas);
+	return true;
+}
+
+/**
+ * Scan 'chunk' with 'parse_entries(s, offset, count)', which parses its comma separated entries.
+ */
+template<typename ParseEntries>
+bool parse_list_chunk(const list_chunk& chunk, ParseEntries& parse_entries)
+{
+	NOMA_TYPA_STATS_PHASE(extraction, chunk.last - chunk.first);
+	structural_index index(chunk.first, chunk.last);
+	scanner s(chunk.first, chunk.last, (static_cast<size_t>(chunk.last - chunk.first) >= structural_index::min_input_size) ? &index : nullptr);
+	return parse_entries(s, chunk.offset, chunk.count) && s.at_end();
+}
+
+/**
+ * Parallel part of try_parse_braced_list(), also used to parse directly into other containers.
+ * Inputs [first, last) of at least parallel_min_input_size are split at top-level commas, Plain
+ * selects the split for entries without structural characters (see is_plain_parser). Then
+ * 'resize(count)' is called with the number of entries, and 'parse_entries(s, offset, count)'
+ * parses 'count' comma separated entries from 's' into the result starting at 'offset', for every
+ * chunk on thread_count() threads.
+ * Returns false if the input is not parsed in parallel or is malformed, the caller uses the serial
+ * parser then, which reports the error. A chunk cannot tell where the serial parser stops, e.g. for
+ * the extra '}' in "{1, 2}}", which a chunk sees as the end of the list.
+ * Exceptions thrown by 'parse_entries' are rethrown for the first chunk in the input, unless an
+ * earlier chunk is malformed.
+ */
+template<typename Plain, typename Resize, typename ParseEntries>
+bool parallel_parse_braced_list(const char* first, const char* last, Plain plain, Resize resize, ParseEntries parse_entries)
+{
+	const size_t threads = thread_count();
+	if (threads == 1 || static_cast<size_t>(last - first) < parallel_min_input_size)
+		return false;
+
+	const char* list_first = skip_whitespace(first, last);
+	const char* list_last = last;
+	while (list_last != list_first && is_space(*(list_last - 1)))
+		--list_last;
+
+	std::vector<list_chunk> chunks;
+	if (list_last - list_first < 2 || *list_first != '{' || *(list_last - 1) != '}'
+	    || !split_braced_list(list_first, list_last, threads, chunks, plain))
+		return false;
+	if (!resize(chunks.back().offset + chunks.back().count))
+		return false;
+
+	// errors in the order of the input: the first chunk that fails determines the outcome
+	std::vector<char> malformed(chunks.size(), false);
+	std::vector<std::exception_ptr> exceptions(chunks.size());
+	parallel_for(chunks.size(), [&](size_t i) {
+		try {
+			malformed[i] = !parse_list_chunk(chunks[i], parse_entries);
+		} catch (...) {
+			exceptions[i] = std::current_exception();
+		}
+	});
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		if (exceptions[i])
+			std::rethrow_exception(exceptions[i]);
+		if (malformed[i])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Serial parser used by try_parse_braced_list() for a Container.
+ */
+template<typename Container>
+struct list_parser
+{
+	typedef type_to_parser<Container> type;
+};
+
+template<typename T>
+struct list_parser<std::vector<T>>
+{
+	typedef braced_list_parser<type_to_parser<T>> type;
+};
+
+template<typename T>
+struct list_parser<std::vector<std::vector<T>>>
+{
+	typedef nested_list_parser<type_to_parser<typename list_nesting<T>::leaf>> type;
+};
+
+} // namespace detail
+
+/**
+ * Parse a braced list into 'result', see parse_braced_list(). Returns false on malformed input, with
+ * 'error_position' pointing to where parsing stopped, i.e. the earliest offending position.
+ * Inputs of at least parallel_min_input_size are split at top-level commas and parsed by
+ * thread_count() threads into consecutive parts of the result. Malformed input is parsed again by
+ * the serial parser, so the reported error is the same.
+ * Container is a std::vector<T>, or a vector<T>, which is filled without intermediate containers.
+ */
+template<typename Container>
+bool try_parse_braced_list(const char* first, const char* last, Container& result, const char*& error_position)
+{
+	typedef typename Container::value_type T;
+	typedef type_to_parser<T> entry_parser;
+
+	auto resize = [&](size_t count) {
+		result.resize(count);
+		return true;
+	};
+	auto parse_entries = [&](scanner& s, size_t offset, size_t count) {
+		T* values = result.data() + offset;
+		bool valid = true;
+		for (size_t i = 0; valid && i < count; ++i)
+			valid = (i == 0 || s.consume(',')) && entry_parser::parse(s, values[i]);
+		return valid;
+	};
+	if (detail::parallel_parse_braced_list(first, last, detail::is_plain_parser<entry_parser>(), resize, parse_entries))
+		return true;
+
+	// validate and extract in one pass
+	return parse_whole<typename detail::list_parser<Container>::type>(first, last, result, error_position);
+}
+
 /**
  * Parse a braced list into a std::vector for an entry type T.
  * Input Format: "{T, T, ...}"
  * T can be a braced list, too.
+ * The input range [first, last) is neither copied nor modified, whitespace is skipped while parsing.
+ * Large inputs are parsed in parallel if thread_count() > 1, see try_parse_braced_list().
  */
 template<typename T>
-std::vector<T> parse_braced_list(const std::string& input)
+std::vector<T> parse_braced_list(const char* first, const char* last)
 {
-	const std::string input_no_ws { remove_whitespace(input) };
-	const std::regex entry_exp { type_to_regexp<T>::exp_str() };
-	const std::regex list_exp { make_braced_list(type_to_regexp<T>::exp_str() ) };
+	NOMA_TYPA_STATS_CALL("noma::typa::parse_braced_list()");
+	std::vector<T> result;
+	const char* error_position;
 
-	// check format
-	if(!std::regex_match(input_no_ws, list_exp))
-		throw parser_error("noma::typa::parse_braced_list(): error: malformed input, should be comma separated braced list, e.g. { T, T, ..}.");
+	if (!try_parse_braced_list(first, last, result, error_position))
+		throw parser_error("noma::typa::parse_braced_list(): error: malformed input at offset " + std::to_string(error_position - first) + ", should be comma separated braced list, e.g. { T, T, ..}.");
+
+	return result;
+}
+
+template<typename T>
+std::vector<T> parse_braced_list(const std::string& input)
+{
+	return parse_braced_list<T>(input.data(), input.data() + input.size());
+}
 
+/**
+ * Parse a braced list from the current line of 'in', which is read in chunks while parsing instead of
+ * being copied into a string first.
+ */
+template<typename T>
+std::vector<T> parse_braced_list(std::istream& in)
+{
+	NOMA_TYPA_STATS_CALL("noma::typa::parse_braced_list()");
 	std::vector<T> result;
 
-	std::smatch sm;
-	std::string::const_iterator cit = input_no_ws.cbegin();
-	while (std::regex_search(cit, input_no_ws.cend(), sm, entry_exp)) {
-		//std::cout << "#Matches: " << sm.size() << std::endl;
-		for (auto& m : sm) {
-			//	std::cout << "\t\t" << m.str() << std::endl;
-			result.push_back(string_to_value<T>::parse(m.str())); // TODO: catch exception here?
-		}
-		cit = sm[0].second; // start of remaining string
-	}
+	if (!parse_stream<typename detail::list_parser<std::vector<T>>::type>(in, result))
+		throw parser_error("noma::typa::parse_braced_list(): error: malformed input, should be comma separated braced list, e.g. { T, T, ..}.");
 
 	return result;
 }
@@ -0,0 +1,88 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_decompressor_hpp
+#define noma_typa_decompressor_hpp
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace noma {
+namespace typa {
+
+/**
+ * Compression formats recognised by the file protocol, see detect_compression().
+ * gzip needs zlib (CMake option NOMA_TYPA_GZIP, on by default), zstd needs libzstd (CMake option
+ * NOMA_TYPA_ZSTD, off by default). Files in a format that is not compiled in are rejected with a
+ * parser_error.
+ */
+enum class compression { none, gzip, zstd };
+
+/**
+ * Detect the compression of the file contents [first, last) by their magic bytes.
+ */
+compression detect_compression(const char* first, const char* last);
+
+namespace detail {
+
+class decompression_stream;
+
+} // namespace detail
+
+/**
+ * Decompresses [first, last) on a separate thread into windows of about window_size bytes, which
+ * next() hands out in order, so the caller can convert one window while the next is decompressed.
+ * Windows end at whitespace or at the end of the data, i.e. no whitespace separated token is split
+ * between two windows.
+ * At most window_count windows are held at any time, a window only grows beyond window_size for a
+ * token that does not fit into it.
+ * Throws parser_error if the format is not supported, errors during decompression are rethrown by
+ * next().
+ */
+class decompressor
+{
+public:
+	decompressor(const std::string& filename, compression format, const char* first, const char* last);
+	~decompressor();
+
+	decompressor(const decompressor&) = delete;
+	decompressor& operator=(const decompressor&) = delete;
+
+	/**
+	 * Get the next window in [first, last), which stays valid until the next call.
+	 * Returns false at the end of the data.
+	 */
+	bool next(const char*& first, const char*& last);
+
+	static const size_t window_size = 4 * 1024 * 1024;
+	static const size_t window_count = 3;
+
+private:
+	void run();
+
+	std::unique_ptr<detail::decompression_stream> stream_;
+	std::vector<std::vector<char>> windows_;
+	std::vector<size_t> sizes_;
+	std::deque<size_t> free_; // windows to be filled
+	std::deque<size_t> full_; // windows to be handed out, in order
+	size_t current_; // handed out by the last next(), window_count if none
+	bool done_ = false;
+	bool stop_ = false;
+	std::exception_ptr error_;
+	std::mutex mutex_;
+	std::condition_variable changed_;
+	std::thread thread_;
+};
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_decompressor_hpp
@@ -0,0 +1,289 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_expression_hpp
+#define noma_typa_expression_hpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "noma/typa/parallel.hpp"
+
+namespace noma {
+namespace typa {
+
+/**
+ * Expression templates for lazy, elementwise arithmetic on vector and matrix.
+ * Operators and functions below do not compute anything, they return light-weight expression objects.
+ * Assigning an expression to a vector or matrix evaluates it in a single loop over the rows of the
+ * result, without temporaries, e.g. y = a * x + b * z reads x and z once and writes y once.
+ * Every expression E provides
+ *     typedef ... value_type;
+ *     static const size_t dimensions; // 0 for scalars, 1 for vectors, 2 for matrices
+ *     size_t rows() const; size_t cols() const; // vectors are a single row
+ *     value_type eval(size_t i, size_t j) const; // element (i, j)
+ * Operands of different shapes are rejected with std::invalid_argument when the expression is built.
+ * NOTE: Expressions refer to the data of their vector and matrix operands, they must not outlive them.
+ */
+
+/**
+ * CRTP base of all expression types.
+ */
+template<typename E>
+struct expression
+{
+	const E& derived() const { return static_cast<const E&>(*this); }
+};
+
+/**
+ * Leaf referring to contiguous rows of elements, 'stride' elements apart, i.e. the data of a vector
+ * (Dimensions = 1) or matrix (Dimensions = 2).
+ */
+template<typename T, size_t Dimensions>
+class array_expression : public expression<array_expression<T, Dimensions>>
+{
+public:
+	typedef T value_type;
+	static const size_t dimensions = Dimensions;
+
+	array_expression(const T* data, size_t rows, size_t cols, size_t stride) : data_(data), rows_(rows), cols_(cols), stride_(stride) { }
+
+	size_t rows() const { return rows_; }
+	size_t cols() const { return cols_; }
+	value_type eval(size_t i, size_t j) const { return data_[i * stride_ + j]; }
+
+private:
+	const T* data_;
+	size_t rows_;
+	size_t cols_;
+	size_t stride_;
+};
+
+/**
+ * Leaf for a scalar operand, broadcast to every element.
+ */
+template<typename T>
+class scalar_expression : public expression<scalar_expression<T>>
+{
+public:
+	typedef T value_type;
+	static const size_t dimensions = 0;
+
+	explicit scalar_expression(const T& value) : value_(value) { }
+
+	size_t rows() const { return 0; }
+	size_t cols() const { return 0; }
+	value_type eval(size_t, size_t) const { return value_; }
+
+private:
+	T value_;
+};
+
+template<typename Op, typename E>
+class unary_expression : public expression<unary_expression<Op, E>>
+{
+public:
+	typedef decltype(Op()(std::declval<typename E::value_type>())) value_type;
+	static const size_t dimensions = E::dimensions;
+
+	explicit unary_expression(const E& e) : e_(e) { }
+
+	size_t rows() const { return e_.rows(); }
+	size_t cols() const { return e_.cols(); }
+	value_type eval(size_t i, size_t j) const { return Op()(e_.eval(i, j)); }
+
+private:
+	E e_;
+};
+
+template<typename Op, typename L, typename R>
+class binary_expression : public expression<binary_expression<Op, L, R>>
+{
+	static_assert(L::dimensions == R::dimensions || L::dimensions == 0 || R::dimensions == 0, "noma::typa::binary_expression: vector and matrix operands cannot be mixed.");
+
+public:
+	typedef decltype(Op()(std::declval<typename L::value_type>(), std::declval<typename R::value_type>())) value_type;
+	static const size_t dimensions = (L::dimensions > R::dimensions) ? L::dimensions : R::dimensions;
+
+	binary_expression(const L& l, const R& r) : l_(l), r_(r)
+	{
+		if (L::dimensions != 0 && R::dimensions != 0 && (l.rows() != r.rows() || l.cols() != r.cols()))
+			throw std::invalid_argument("noma::typa::binary_expression::binary_expression(): error: operands of different shapes, " + std::to_string(l.rows()) + " x " + std::to_string(l.cols()) + " and " + std::to_string(r.rows()) + " x " + std::to_string(r.cols()) + ".");
+	}
+
+	size_t rows() const { return (L::dimensions != 0) ? l_.rows() : r_.rows(); }
+	size_t cols() const { return (L::dimensions != 0) ? l_.cols() : r_.cols(); }
+	value_type eval(size_t i, size_t j) const { return Op()(l_.eval(i, j), r_.eval(i, j)); }
+
+private:
+	L l_;
+	R r_;
+};
+
+/**
+ * Type trait for the operands of the operators below, 'value' is true for expressions and for the
+ * types specialising it, i.e. vector and matrix. 'type' is the expression stored for an operand,
+ * created by make().
+ */
+template<typename X, typename Enable = void>
+struct expression_operand
+{
+	static const bool value = false;
+};
+
+template<typename X>
+struct expression_operand<X, typename std::enable_if<std::is_base_of<expression<X>, X>::value>::type>
+{
+	static const bool value = true;
+	typedef X type;
+	static const X& make(const X& x) { return x; }
+};
+
+/**
+ * True if S is used as a scalar with the operand X, i.e. S is not an operand itself and converts to
+ * the value_type of X without losing its kind, e.g. int for a vector of double, but not double for a
+ * vector of int, where 'v * 0.5' would multiply by 0. Floating point scalars of any precision are
+ * used with floating point values, e.g. 'v * 2.0' for a vector of float, converted to float.
+ */
+template<typename S, typename X, typename Enable = void>
+struct is_scalar_operand : std::false_type
+{
+};
+
+template<typename S, typename X>
+struct is_scalar_operand<S, X, typename std::enable_if<expression_operand<X>::value && !expression_operand<S>::value
+                                                       && std::is_convertible<S, typename expression_operand<X>::type::value_type>::value>::type>
+	: std::integral_constant<bool, std::is_same<typename std::common_type<typename expression_operand<X>::type::value_type, S>::type, typename expression_operand<X>::type::value_type>::value
+	                               || (std::is_floating_point<S>::value && std::is_floating_point<typename expression_operand<X>::type::value_type>::value)>
+{
+};
+
+/**
+ * Elementwise operations, applied via unary_expression and binary_expression.
+ */
+namespace ops {
+
+struct negate { template<typename A> auto operator()(const A& a) const -> decltype(-a) { return -a; } };
+struct plus { template<typename A, typename B> auto operator()(const A& a, const B& b) const -> decltype(a + b) { return a + b; } };
+struct minus { template<typename A, typename B> auto operator()(const A& a, const B& b) const -> decltype(a - b) { return a - b; } };
+struct multiplies { template<typename A, typename B> auto operator()(const A& a, const B& b) const -> decltype(a * b) { return a * b; } };
+struct divides { template<typename A, typename B> auto operator()(const A& a, const B& b) const -> decltype(a / b) { return a / b; } };
+
+// the std:: functions are found for built-in types, others (e.g. std::complex) via ADL
+struct abs { template<typename A> auto operator()(const A& a) const -> decltype(std::abs(a)) { using std::abs; return abs(a); } };
+struct sqrt { template<typename A> auto operator()(const A& a) const -> decltype(std::sqrt(a)) { using std::sqrt; return sqrt(a); } };
+struct exp { template<typename A> auto operator()(const A& a) const -> decltype(std::exp(a)) { using std::exp; return exp(a); } };
+struct log { template<typename A> auto operator()(const A& a) const -> decltype(std::log(a)) { using std::log; return log(a); } };
+struct sin { template<typename A> auto operator()(const A& a) const -> decltype(std::sin(a)) { using std::sin; return sin(a); } };
+struct cos { template<typename A> auto operator()(const A& a) const -> decltype(std::cos(a)) { using std::cos; return cos(a); } };
+struct pow { template<typename A, typename B> auto operator()(const A& a, const B& b) const -> decltype(std::pow(a, b)) { using std::pow; return pow(a, b); } };
+
+} // namespace ops
+
+/**
+ * Elementwise operators for two operands, or an operand and a scalar on either side, which is
+ * converted to the value_type of the operand.
+ */
+#define NOMA_TYPA_BINARY_OPERATOR(name, op) \
+	template<typename L, typename R> \
+	typename std::enable_if<expression_operand<L>::value && expression_operand<R>::value, \
+	                        binary_expression<op, typename expression_operand<L>::type, typename expression_operand<R>::type>>::type \
+	name(const L& l, const R& r) \
+	{ \
+		typedef binary_expression<op, typename expression_operand<L>::type, typename expression_operand<R>::type> result_type; \
+		return result_type(expression_operand<L>::make(l), expression_operand<R>::make(r)); \
+	} \
+	\
+	template<typename L, typename S> \
+	typename std::enable_if<is_scalar_operand<S, L>::value, \
+	                        binary_expression<op, typename expression_operand<L>::type, scalar_expression<typename expression_operand<L>::type::value_type>>>::type \
+	name(const L& l, const S& s) \
+	{ \
+		typedef scalar_expression<typename expression_operand<L>::type::value_type> scalar_type; \
+		typedef binary_expression<op, typename expression_operand<L>::type, scalar_type> result_type; \
+		return result_type(expression_operand<L>::make(l), scalar_type(s)); \
+	} \
+	\
+	template<typename S, typename R> \
+	typename std::enable_if<is_scalar_operand<S, R>::value, \
+	                        binary_expression<op, scalar_expression<typename expression_operand<R>::type::value_type>, typename expression_operand<R>::type>>::type \
+	name(const S& s, const R& r) \
+	{ \
+		typedef scalar_expression<typename expression_operand<R>::type::value_type> scalar_type; \
+		typedef binary_expression<op, scalar_type, typename expression_operand<R>::type> result_type; \
+		return result_type(scalar_type(s), expression_operand<R>::make(r)); \
+	}
+
+NOMA_TYPA_BINARY_OPERATOR(operator+, ops::plus)
+NOMA_TYPA_BINARY_OPERATOR(operator-, ops::minus)
+NOMA_TYPA_BINARY_OPERATOR(operator*, ops::multiplies) // elementwise
+NOMA_TYPA_BINARY_OPERATOR(operator/, ops::divides)
+NOMA_TYPA_BINARY_OPERATOR(pow, ops::pow)
+
+#undef NOMA_TYPA_BINARY_OPERATOR
+
+/**
+ * Elementwise negation and math functions.
+ */
+#define NOMA_TYPA_UNARY_FUNCTION(name, op) \
+	template<typename X> \
+	typename std::enable_if<expression_operand<X>::value, unary_expression<op, typename expression_operand<X>::type>>::type \
+	name(const X& x) \
+	{ \
+		return unary_expression<op, typename expression_operand<X>::type>(expression_operand<X>::make(x)); \
+	}
+
+NOMA_TYPA_UNARY_FUNCTION(operator-, ops::negate)
+NOMA_TYPA_UNARY_FUNCTION(abs, ops::abs)
+NOMA_TYPA_UNARY_FUNCTION(sqrt, ops::sqrt)
+NOMA_TYPA_UNARY_FUNCTION(exp, ops::exp)
+NOMA_TYPA_UNARY_FUNCTION(log, ops::log)
+NOMA_TYPA_UNARY_FUNCTION(sin, ops::sin)
+NOMA_TYPA_UNARY_FUNCTION(cos, ops::cos)
+
+#undef NOMA_TYPA_UNARY_FUNCTION
+
+/**
+ * Evaluate 'e' into 'rows' rows of 'cols' elements at 'data', 'stride' elements apart. One fused loop
+ * per row, rows (or parts of a single row) are distributed over thread_count() threads for large
+ * results.
+ * NOTE: 'data' may be an operand of 'e', as every element only depends on the operands' elements at
+ *       the same position.
+ */
+template<typename E, typename T>
+void evaluate_expression(const E& e, T* data, size_t rows, size_t cols, size_t stride)
+{
+	auto evaluate_part = [&](size_t i_first, size_t i_last, size_t j_first, size_t j_last) {
+		for (size_t i = i_first; i < i_last; ++i) {
+			T* row = data + i * stride;
+			for (size_t j = j_first; j < j_last; ++j)
+				row[j] = e.eval(i, j);
+		}
+	};
+
+	const size_t parts = (rows * cols * sizeof(T) >= parallel_min_input_size) ? thread_count() : 1;
+	if (parts == 1) {
+		evaluate_part(0, rows, 0, cols);
+	} else if (rows == 1) {
+		const size_t part_size = (cols + parts - 1) / parts;
+		parallel_for(parts, [&](size_t p) {
+			evaluate_part(0, 1, std::min(p * part_size, cols), std::min((p + 1) * part_size, cols));
+		});
+	} else {
+		const size_t part_size = (rows + parts - 1) / parts;
+		parallel_for(parts, [&](size_t p) {
+			evaluate_part(std::min(p * part_size, rows), std::min((p + 1) * part_size, rows), 0, cols);
+		});
+	}
+}
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_expression_hpp
@@ -0,0 +1,218 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_format_hpp
+#define noma_typa_format_hpp
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "noma/typa/number.hpp"
+#include "noma/typa/parallel.hpp"
+
+namespace noma {
+namespace typa {
+
+/**
+ * Output counterpart of number.hpp: locale independent formatting of numbers, used by the printers
+ * of all types (operator<<, print(), ...) through format_buffer and value_formatter.
+ */
+
+/**
+ * Maximum number of characters written by format_real() and format_integer().
+ */
+const size_t max_number_chars = 32;
+
+/**
+ * Write the shortest decimal representation of 'value' that parses back to exactly 'value' to 'out'
+ * and return the end of the output, with the Grisu2 algorithm (Loitsch, "Printing Floating-Point
+ * Numbers Quickly and Accurately with Integers", PLDI 2010). Grisu2 always round trips, and finds the
+ * shortest digit string for nearly all values.
+ * Fixed or scientific notation is used, whichever is shorter, e.g. "0.1", "1234.5", "1e-7", "2.5e21".
+ * Infinity and NaN are written as "inf", "-inf" and "nan", like std::ostream does.
+ * NOTE: 'out' must have room for max_number_chars characters.
+ */
+char* format_real(double value, char* out);
+char* format_real(float value, char* out);
+
+/**
+ * Write 'value' in decimal to 'out' and return the end of the output.
+ * NOTE: 'out' must have room for max_number_chars characters.
+ */
+char* format_integer(uint64_t value, char* out);
+char* format_integer(int64_t value, char* out);
+
+/**
+ * Notation of reals written by format_buffer: 'shortest' uses format_real(), 'scientific' and 'fixed'
+ * write a fixed number of digits after the decimal point, like std::scientific and std::fixed.
+ */
+enum class real_notation { shortest, scientific, fixed };
+
+/**
+ * Character buffer the printers format into, before writing the result to a stream at once.
+ * The notation of reals can be taken from a stream, i.e. std::scientific or std::fixed together with
+ * std::setprecision() select a fixed precision, otherwise the shortest round trip representation is
+ * used.
+ */
+class format_buffer
+{
+public:
+	format_buffer() = default;
+
+	explicit format_buffer(const std::ostream& out)
+	{
+		const std::ios_base::fmtflags floatfield = out.flags() & std::ios_base::floatfield;
+		if (floatfield == std::ios_base::scientific)
+			set_real_notation(real_notation::scientific, static_cast<int>(out.precision()));
+		else if (floatfield == std::ios_base::fixed)
+			set_real_notation(real_notation::fixed, static_cast<int>(out.precision()));
+	}
+
+	void set_real_notation(real_notation notation, int precision = 0)
+	{
+		notation_ = notation;
+		precision_ = precision;
+	}
+
+	void append(char c) { data_.push_back(c); }
+	void append(const char* str, size_t size) { data_.append(str, size); }
+	void append(const std::string& str) { data_.append(str); }
+
+	void append_real(double value);
+	void append_real(float value);
+
+	void append_integer(uint64_t value)
+	{
+		char digits[max_number_chars];
+		append(digits, format_integer(value, digits) - digits);
+	}
+
+	void append_integer(int64_t value)
+	{
+		char digits[max_number_chars];
+		append(digits, format_integer(value, digits) - digits);
+	}
+
+	/**
+	 * Append 'value' formatted by value_formatter<T>.
+	 */
+	template<typename T>
+	void append_value(const T& value);
+
+	const std::string& str() const { return data_; }
+	size_t size() const { return data_.size(); }
+	void clear() { data_.clear(); }
+
+	void write_to(std::ostream& out) const
+	{
+		out.write(data_.data(), static_cast<std::streamsize>(data_.size()));
+	}
+
+private:
+	std::string data_;
+	real_notation notation_ = real_notation::shortest;
+	int precision_ = 0;
+};
+
+/**
+ * Type trait used by format_buffer::append_value() to format a T, the output counterpart of
+ * string_to_value. Specialised next to the types, the default streams 'value' with operator<<.
+ */
+template<typename T, typename Enable = void>
+struct value_formatter
+{
+	static void format(format_buffer& out, const T& value)
+	{
+		std::ostringstream oss;
+		oss << value;
+		out.append(oss.str());
+	}
+};
+
+/**
+ * Integers and reals handled by number.hpp, cf. string_to_value in basic_types.hpp.
+ */
+template<typename T>
+struct value_formatter<T, typename std::enable_if<is_fast_number<T>::value>::type>
+{
+	static void format(format_buffer& out, const T& value)
+	{
+		append(out, value, std::is_floating_point<T>(), std::is_signed<T>());
+	}
+
+private:
+	static void append(format_buffer& out, T value, std::true_type, std::true_type) { out.append_real(value); }
+	static void append(format_buffer& out, T value, std::false_type, std::true_type) { out.append_integer(static_cast<int64_t>(value)); }
+	static void append(format_buffer& out, T value, std::false_type, std::false_type) { out.append_integer(static_cast<uint64_t>(value)); }
+};
+
+// Output Format: "(re,im)", like std::ostream
+template<typename T>
+struct value_formatter<std::complex<T>, typename std::enable_if<is_fast_number<T>::value>::type>
+{
+	static void format(format_buffer& out, const std::complex<T>& value)
+	{
+		out.append('(');
+		value_formatter<T>::format(out, value.real());
+		out.append(',');
+		value_formatter<T>::format(out, value.imag());
+		out.append(')');
+	}
+};
+
+template<typename T>
+void format_buffer::append_value(const T& value)
+{
+	value_formatter<T>::format(*this, value);
+}
+
+/**
+ * Number of elements formatted into one chunk by write_formatted(), i.e. the output reaches the
+ * stream in pieces of format_chunk_size elements, a few hundred KiB for numbers.
+ */
+const size_t format_chunk_size = 8192;
+
+/**
+ * Write 'count' elements to 'out' in chunks, where 'format_range(buffer, first, last)' appends the
+ * elements [first, last) with their separators to a format_buffer. Each chunk is written as soon as
+ * it is formatted, so memory use is bounded independently of 'count', and formatting stops when
+ * 'out' fails, e.g. on a full disk.
+ * Large outputs, i.e. 'count' elements of 'element_size' bytes covering at least
+ * parallel_min_input_size, are formatted by thread_count() threads, one chunk each, and written in
+ * order after every round.
+ */
+template<typename F>
+void write_formatted(std::ostream& out, size_t count, size_t element_size, F format_range)
+{
+	const size_t chunk_count = (count + format_chunk_size - 1) / format_chunk_size;
+	const size_t parts = (count * element_size >= parallel_min_input_size) ? std::min(thread_count(), chunk_count) : 1;
+	std::vector<format_buffer> buffers(parts, format_buffer(out));
+
+	for (size_t round_first = 0; round_first < chunk_count && out; round_first += parts) {
+		const size_t round_size = std::min(parts, chunk_count - round_first);
+		auto format_chunk = [&](size_t p) {
+			const size_t first = (round_first + p) * format_chunk_size;
+			buffers[p].clear();
+			format_range(buffers[p], first, std::min(first + format_chunk_size, count));
+		};
+		if (round_size == 1)
+			format_chunk(0);
+		else
+			parallel_for(round_size, format_chunk);
+		for (size_t p = 0; p < round_size; ++p)
+			buffers[p].write_to(out);
+	}
+}
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_format_hpp
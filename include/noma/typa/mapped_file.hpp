@@ -0,0 +1,41 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_mapped_file_hpp
+#define noma_typa_mapped_file_hpp
+
+#include <cstddef>
+#include <string>
+
+namespace noma {
+namespace typa {
+
+/**
+ * Read-only view of a whole file, memory mapped where supported (POSIX), otherwise read into memory.
+ * Throws parser_error if the file cannot be opened.
+ */
+class mapped_file
+{
+public:
+	explicit mapped_file(const std::string& filename);
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	const char* data() const { return data_; }
+	size_t size() const { return size_; }
+	const char* begin() const { return data_; }
+	const char* end() const { return data_ + size_; }
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	bool mapped_ = false;
+};
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_mapped_file_hpp
@@ -5,61 +5,101 @@
 #ifndef noma_typa_matrix_hpp
 #define noma_typa_matrix_hpp
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstring> // memcpy()
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 #include "debug.hpp"
+#include "noma/typa/aligned_memory.hpp"
+#include "noma/typa/expression.hpp"
+#include "noma/typa/parallel.hpp"
 #include "noma/typa/typa.hpp"
 
 namespace noma {
 namespace typa {
 
-template<typename T>
+/**
+ * Row major matrix, the storage is aligned to Alignment bytes and obtained from Allocator, which must
+ * provide that alignment.
+ * Consecutive rows are stride() elements apart, which is cols() unless the matrix is padded(), then
+ * every row starts aligned (see padded_stride()).
+ * Storage is reused by resize() and assignment as long as it is large enough.
+ */
+template<typename T, size_t Alignment = default_alignment, typename Allocator = aligned_allocator<T, Alignment>>
 class matrix {
+	static_assert(is_valid_alignment(Alignment) && Alignment >= alignof(T), "noma::typa::matrix<T, Alignment, Allocator>: Alignment must be a power of two and at least alignof(T).");
+
+	typedef std::allocator_traits<Allocator> allocator_traits;
+
 public:
+	typedef T value_type;
+	typedef Allocator allocator_type;
+
+	static const size_t alignment = Alignment;
+
 	matrix() = default;
 
-	matrix(size_t rows, size_t cols, T value = T()) : rows_(rows), cols_(cols)
+	explicit matrix(const Allocator& alloc) : alloc_(alloc) { }
+
+	matrix(size_t rows, size_t cols, T value = T(), bool padded = false, const Allocator& alloc = Allocator())
+		: padded_(padded), alloc_(alloc)
 	{
-		allocate();
+		resize(rows, cols);
 		init(value);
 	}
 
 	// copy
 	matrix(const matrix& other)
-		: rows_(other.rows_), cols_(other.cols_)
+		: padded_(other.padded_), alloc_(allocator_traits::select_on_container_copy_construction(other.alloc_))
 	{
-		allocate();
-		for (size_t i = 0; i < rows_; ++i) {
-			for (size_t j = 0; j < cols_; ++j) {
-				at(i, j) = other.at(i, j);
-			}
-		}
+		reshape(other.rows_, other.cols_, other.stride_);
+		copy(other);
 	}
 
-	// assignment
+	// assignment, reuses the storage if it is large enough
 	matrix& operator=(const matrix& other)
 	{
-		deallocate();
-		rows_ = other.rows_;
-		cols_ = other.cols_;
-		allocate();
-		for (size_t i = 0; i < rows_; ++i) {
-			for (size_t j = 0; j < cols_; ++j) {
-				at(i, j) = other.at(i, j);
-			}
-		}
+		if (this == &other)
+			return *this;
+		assign_allocator(other.alloc_, typename allocator_traits::propagate_on_container_copy_assignment());
+		padded_ = other.padded_;
+		reshape(other.rows_, other.cols_, other.stride_);
+		copy(other);
 
 		return *this;
 	}
 
 	// move
-	matrix(matrix&& other)
-		: rows_(other.rows_), cols_(other.cols_)
+	matrix(matrix&& other) noexcept
+		: data_(other.data_), capacity_(other.capacity_), rows_(other.rows_), cols_(other.cols_), stride_(other.stride_), padded_(other.padded_), alloc_(std::move(other.alloc_))
+	{
+		other.release(); // move ownership
+	}
+
+	// move assignment, takes over the storage unless the allocators differ and do not propagate
+	matrix& operator=(matrix&& other) noexcept(allocator_traits::propagate_on_container_move_assignment::value)
 	{
-		data_ = other.data_; // move ownership
-		other.data_ = nullptr; // invalidate
+		if (this == &other)
+			return *this;
+		move_assign(other, typename allocator_traits::propagate_on_container_move_assignment());
+
+		return *this;
+	}
+
+	/**
+	 * Evaluate an elementwise matrix expression, see expression.hpp.
+	 */
+	template<typename E>
+	matrix(const expression<E>& e, bool padded = false, const Allocator& alloc = Allocator())
+		: padded_(padded), alloc_(alloc)
+	{
+		*this = e;
 	}
 
 	~matrix()
@@ -67,154 +107,568 @@ public:
 		deallocate();
 	}
 
+	/**
+	 * Evaluate an elementwise matrix expression in a single loop per row, e.g. c = a * x + b * z, see
+	 * expression.hpp. The matrix is resized to the shape of 'e', keeping padded().
+	 */
+	template<typename E>
+	matrix& operator=(const expression<E>& e)
+	{
+		static_assert(E::dimensions == 2, "noma::typa::matrix<T, Alignment, Allocator>::operator=(): not a matrix expression.");
+		if (e.derived().rows() != rows_ || e.derived().cols() != cols_)
+			resize(e.derived().rows(), e.derived().cols());
+		evaluate_expression(e.derived(), data_, rows_, cols_, stride_);
+		return *this;
+	}
+
+	// elementwise with a matrix, a matrix expression or a scalar
+	template<typename X>
+	matrix& operator+=(const X& x) { return *this = *this + x; }
+	template<typename X>
+	matrix& operator-=(const X& x) { return *this = *this - x; }
+	template<typename X>
+	matrix& operator*=(const X& x) { return *this = *this * x; }
+	template<typename X>
+	matrix& operator/=(const X& x) { return *this = *this / x; }
+
+	allocator_type get_allocator() const { return alloc_; }
+
 	//T* data() { return data_; }
 	T const * data() const { return data_; }
 	T* data() { return data_; }
 	size_t rows() const { return rows_; }
 	size_t cols() const { return cols_; }
 
+	/**
+	 * Leading dimension, i.e. the distance between the beginnings of consecutive rows in elements.
+	 */
+	size_t stride() const { return stride_; }
+
+	bool padded() const { return padded_; }
+
 	T const & at(size_t i, size_t j) const
 	{
 		assert(i < rows_ && j < cols_);
-		return data_[i * cols_ + j];
+		return data_[i * stride_ + j];
 	}
 
 	T& at(size_t i, size_t j)
 	{
 		assert(i < rows_ && j < cols_);
-		return data_[i * cols_ + j];
+		return data_[i * stride_ + j];
 	}
 
+	/**
+	 * Resize to 'rows' x 'cols', the contents are not preserved. The layout follows padded(). The
+	 * storage is only reallocated if it is too small.
+	 */
 	void resize(size_t rows, size_t cols)
 	{
-		rows_ = rows;
-		cols_ = cols;
+		reshape(rows, cols, padded_ ? padded_stride(cols) : cols);
+	}
+
+	/**
+	 * Make room for 'rows' rows with the current stride(), preserving the contents, i.e. the matrix can
+	 * grow up to 'rows' rows via resize() with the same cols() without losing them.
+	 */
+	void reserve_rows(size_t rows)
+	{
+		if (rows * stride_ <= capacity_)
+			return;
+		NOMA_TYPA_STATS_PHASE(fill, rows_ * stride_ * sizeof(T));
+		T* data = allocate_elements(alloc_, rows * stride_);
+		std::move(data_, data_ + rows_ * stride_, data);
+		const size_t old_rows = rows_, cols = cols_, stride = stride_;
 		deallocate();
-		allocate();
+		data_ = data;
+		capacity_ = rows * stride;
+		reshape(old_rows, cols, stride);
+		assert(reinterpret_cast<uintptr_t>(data_) % Alignment == 0);
 	}
 
-	matrix<T> transposed() const
+	/**
+	 * Number of elements the storage can hold without reallocation, including padding.
+	 */
+	size_t capacity() const { return capacity_; }
+
+	/**
+	 * Switch between padded and dense rows, the contents are preserved. Also applies to the following
+	 * resize() calls, e.g. by operator>>.
+	 */
+	void set_padded(bool padded)
 	{
-		matrix<T> result(rows_, cols_);
-		for (size_t i = 0; i < rows_; ++i) {
-			for (size_t j = 0; j < cols_; ++j) {
-				result.at(j,i) = this->at(i,j);
+		if (padded == padded_)
+			return;
+		matrix result(alloc_);
+		result.padded_ = padded;
+		result.resize(rows_, cols_);
+		result.copy(*this);
+		swap(result);
+	}
+
+	/**
+	 * Leading dimension of a padded matrix with 'cols' columns: rounded up to whole multiples of
+	 * Alignment bytes, so that all rows are aligned, plus another Alignment bytes if the row size would
+	 * be a multiple of 4 KiB, as the same column of consecutive rows would map to the same L1 cache set
+	 * then. Rows cannot be aligned if Alignment is not a multiple of sizeof(T), 'cols' is returned then.
+	 */
+	static size_t padded_stride(size_t cols)
+	{
+		if (Alignment % sizeof(T) != 0)
+			return cols;
+		const size_t alignment_elements = Alignment / sizeof(T);
+		size_t stride = (cols + alignment_elements - 1) / alignment_elements * alignment_elements;
+		if (stride > 0 && (stride * sizeof(T)) % 4096 == 0)
+			stride += alignment_elements;
+		return stride;
+	}
+
+	/**
+	 * Returns the cols() x rows() transpose.
+	 * Works on tiles of transpose_tile_size^2 elements, bands of tiles are distributed over
+	 * thread_count() threads for large matrices.
+	 */
+	matrix transposed() const
+	{
+		matrix result(alloc_);
+		result.padded_ = padded_;
+		result.resize(cols_, rows_);
+		const size_t ld = stride_;
+		const size_t result_ld = result.stride_;
+		T* result_data = result.data_;
+		for_each_tile_band(rows_, [&](size_t i_first, size_t i_last) {
+			for (size_t j_first = 0; j_first < cols_; j_first += transpose_tile_size) {
+				const size_t j_last = std::min(j_first + transpose_tile_size, cols_);
+				// write contiguously, the strided reads hit the source tile in L1
+				for (size_t j = j_first; j < j_last; ++j)
+					for (size_t i = i_first; i < i_last; ++i)
+						result_data[j * result_ld + i] = data_[i * ld + j];
 			}
-		}
+		});
 		return result;
 	}
 
-	void print_raw(std::ostream& out, const char& delimiter = '\t') const
+	/**
+	 * Transpose in place, tiled and parallel like transposed().
+	 * NOTE: Only square matrices are transposed without additional memory, others are replaced by
+	 *       transposed().
+	 */
+	void transpose()
 	{
-		std::ostringstream oss;
-		oss.precision(std::numeric_limits<double>::max_digits10);
-		oss << std::scientific;
+		if (rows_ != cols_) {
+			matrix result = transposed();
+			swap(result);
+			return;
+		}
 
-		for (size_t i = 0; i < rows_; ++i) {
-			for (size_t j = 0; j < cols_; ++j) {
-				oss << at(i,j)
-				    << ((j == cols_ - 1) ? '\n' : delimiter);
+		// swap every tile above the diagonal with its mirror below, bands of tiles are disjoint
+		const size_t n = rows_;
+		const size_t ld = stride_;
+		for_each_tile_band(n, [&](size_t i_first, size_t i_last) {
+			for (size_t i = i_first; i < i_last; ++i) // diagonal tile
+				for (size_t j = i + 1; j < i_last; ++j)
+					std::swap(data_[i * ld + j], data_[j * ld + i]);
+			for (size_t j_first = i_last; j_first < n; j_first += transpose_tile_size) {
+				const size_t j_last = std::min(j_first + transpose_tile_size, n);
+				for (size_t i = i_first; i < i_last; ++i)
+					for (size_t j = j_first; j < j_last; ++j)
+						std::swap(data_[i * ld + j], data_[j * ld + i]);
 			}
-		}
+		});
+	}
 
-		out << oss.str();
+	/**
+	 * Write the elements row by row, one row per line, separated by 'delimiter'. Like all printers,
+	 * reals are written in their shortest round trip representation, unless 'out' is set to
+	 * std::scientific or std::fixed (see format_buffer). Output is written in chunks as it is formatted,
+	 * by multiple threads for large matrices (see write_formatted()).
+	 */
+	void print_raw(std::ostream& out, const char& delimiter = '\t') const
+	{
+		write_elements(out, [&](format_buffer& buffer, size_t i, size_t j) {
+			buffer.append_value(at(i,j));
+			buffer.append((j == cols_ - 1) ? '\n' : delimiter);
+		});
 	}
 
-	void print_flat(std::ostream& out) const
+	/**
+	 * Write the matrix to 'filename' in NumPy's binary .npy format, see npy.hpp.
+	 */
+	void save_npy(const std::string& filename) const
 	{
-		std::ostringstream oss;
-		oss.precision(std::numeric_limits<double>::max_digits10);
-		oss << std::scientific;
+		write_npy(filename, npy_descr<T>::value(), { rows_, cols_ }, data_, rows_ * cols_ * sizeof(T), stride_ * sizeof(T));
+	}
 
-		oss << "{";
-		for (size_t i = 0; i < rows_; ++i) {
-			for (size_t j = 0; j < cols_; ++j) {
-				oss << at(i,j);
-				if ((i * cols_ + j) < (cols_ * rows_) - 1)
-					oss << ',';
-			}
-		}
-		oss << "}";
+	/**
+	 * Read the matrix from a .npy file holding a 2-dimensional array of T, in C or Fortran order.
+	 * The file is memory mapped, a C order payload is copied with a single memcpy(), or one per row if
+	 * the matrix is padded().
+	 * Throws parser_error if T is not trivially copyable.
+	 */
+	void load_npy(const std::string& filename)
+	{
+		load_npy(filename, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+	}
 
-		out << oss.str();
+	void print_flat(std::ostream& out) const
+	{
+		out.put('{');
+		write_elements(out, [&](format_buffer& buffer, size_t i, size_t j) {
+			buffer.append_value(at(i,j));
+			if ((i * cols_ + j) < (cols_ * rows_) - 1)
+				buffer.append(',');
+		});
+		out.put('}');
 	}
 
 	void print(std::ostream& out) const
 	{
-		std::ostringstream oss;
-		oss.precision(std::numeric_limits<double>::max_digits10);
-		oss << std::scientific;
+		out.put('{');
+		if (cols_ == 0) { // no elements to write the braces of the rows with
+			for (size_t i = 0; i < rows_; ++i)
+				out << ((i == 0) ? "{}" : ",{}");
+			out.put('}');
+			return;
+		}
+		write_elements(out, [&](format_buffer& buffer, size_t i, size_t j) {
+			if (j == 0)
+				buffer.append('{');
+			buffer.append_value(at(i,j));
+			if (j < cols_ - 1) {
+				buffer.append(',');
+			} else {
+				buffer.append('}');
+				if (i < rows_ - 1)
+					buffer.append(',');
+			}
+		});
+		out.put('}');
+	}
 
-		oss << "{";
+	void scale(T factor)
+	{
 		for (size_t i = 0; i < rows_; ++i) {
-			oss << "{";
-			for (size_t j = 0; j < cols_; ++j) {
-				oss << at(i,j);
-				if (j < cols_ - 1)
-					oss << ',';
+			T* row = data_ + i * stride_;
+			for (size_t j = 0; j < cols_; ++j)
+				row[j] *= factor;
+		}
+	}
 
-			}
-			oss << "}";
-			if (i < rows_ - 1)
-				oss << ',';
+	// edge length of the tiles used by transpose(): 32 x 32 doubles are 8 KiB, i.e. source and
+	// destination tile fit into L1, while every row of a tile still covers whole cache lines
+	static const size_t transpose_tile_size = 32;
+
+private:
+	void load_npy(const std::string& filename, std::true_type)
+	{
+		const npy_file file(filename);
+		const char* payload = file.payload<T>(2);
+		resize(file.shape()[0], file.shape()[1]);
+		NOMA_TYPA_STATS_PHASE(fill, rows_ * cols_ * sizeof(T));
+		if (!file.fortran_order() && stride_ == cols_) {
+			std::memcpy(data_, payload, rows_ * cols_ * sizeof(T));
+		} else if (!file.fortran_order()) {
+			for (size_t i = 0; i < rows_; ++i)
+				std::memcpy(data_ + i * stride_, payload + i * cols_ * sizeof(T), cols_ * sizeof(T));
+		} else {
+			for (size_t j = 0; j < cols_; ++j)
+				for (size_t i = 0; i < rows_; ++i)
+					std::memcpy(&at(i, j), payload + (j * rows_ + i) * sizeof(T), sizeof(T));
 		}
-		oss << "}";
+	}
 
-		out << oss.str();
+	void load_npy(const std::string&, std::false_type)
+	{
+		throw parser_error("noma::typa::matrix<T>::load_npy(): error: .npy files need a trivially copyable element type.");
 	}
 
-	void scale(T factor)
+	/**
+	 * Write all elements in row-major order via write_formatted(), i.e. in bounded chunks, where
+	 * 'format_element(buffer, i, j)' appends element (i, j) and its separators.
+	 */
+	template<typename F>
+	void write_elements(std::ostream& out, F format_element) const
 	{
-		for (size_t i = 0; i < rows_; ++i)
-			for (size_t j = 0; j < cols_; ++j) {
-				at(i,j) *= factor;
+		write_formatted(out, rows_ * cols_, sizeof(T), [&](format_buffer& buffer, size_t first, size_t last) {
+			size_t i = first / cols_;
+			size_t j = first % cols_;
+			for (size_t k = first; k < last; ++k) {
+				format_element(buffer, i, j);
+				if (++j == cols_) {
+					j = 0;
+					++i;
+				}
 			}
+		});
 	}
 
-private:
-	void allocate()
+	/**
+	 * Call 'func(i_first, i_last)' for every band of transpose_tile_size rows in [0, rows), in parallel
+	 * for large matrices.
+	 */
+	template<typename F>
+	void for_each_tile_band(size_t rows, F func) const
 	{
-		assert(data_ == nullptr);
-		data_ = new T[rows_ * cols_];
+		const size_t bands = (rows + transpose_tile_size - 1) / transpose_tile_size;
+		auto band = [&](size_t b) {
+			func(b * transpose_tile_size, std::min((b + 1) * transpose_tile_size, rows));
+		};
+		if (rows_ * cols_ * sizeof(T) >= parallel_min_input_size) {
+			parallel_for(bands, band);
+		} else {
+			for (size_t b = 0; b < bands; ++b)
+				band(b);
+		}
+	}
+
+	/**
+	 * Set the shape, reallocating only if 'rows' * 'stride' exceeds the capacity.
+	 */
+	void reshape(size_t rows, size_t cols, size_t stride)
+	{
+		if (rows * stride > capacity_) {
+			deallocate();
+			data_ = allocate_elements(alloc_, rows * stride);
+			capacity_ = rows * stride;
+			assert(reinterpret_cast<uintptr_t>(data_) % Alignment == 0);
+		}
+		rows_ = rows;
+		cols_ = cols;
+		stride_ = stride;
 	}
 
 	void deallocate()
 	{
-		if (data_) {
-			delete [] data_;
-			data_ = nullptr;
+		deallocate_elements(alloc_, data_, capacity_);
+		release();
+	}
+
+	// forget the storage without releasing it, after moving it elsewhere
+	void release()
+	{
+		data_ = nullptr;
+		capacity_ = 0;
+		rows_ = 0;
+		cols_ = 0;
+		stride_ = 0;
+	}
+
+	/**
+	 * Copy the elements of 'other', which has the same shape, with a single copy_elements() if the
+	 * strides match, otherwise row by row.
+	 */
+	void copy(const matrix& other)
+	{
+		if (rows_ == 0)
+			return;
+		if (stride_ == other.stride_) {
+			copy_elements(other.data_, (rows_ - 1) * stride_ + cols_, data_);
+		} else {
+			for (size_t i = 0; i < rows_; ++i)
+				copy_elements(other.data_ + i * other.stride_, cols_, data_ + i * stride_);
 		}
 	}
-	void init(T value) {
-		for (size_t i = 0; i < rows_; ++i) {
-			for (size_t j = 0; j < cols_; ++j) {
-				at(i, j) = value;
-			}
+
+	void swap(matrix& other)
+	{
+		std::swap(data_, other.data_);
+		std::swap(capacity_, other.capacity_);
+		std::swap(rows_, other.rows_);
+		std::swap(cols_, other.cols_);
+		std::swap(stride_, other.stride_);
+		std::swap(padded_, other.padded_);
+		std::swap(alloc_, other.alloc_);
+	}
+
+	void assign_allocator(const Allocator& alloc, std::true_type)
+	{
+		if (alloc_ != alloc)
+			deallocate(); // the storage must be released by the allocator it came from
+		alloc_ = alloc;
+	}
+
+	void assign_allocator(const Allocator&, std::false_type) { }
+
+	void move_assign(matrix& other, std::true_type)
+	{
+		deallocate();
+		alloc_ = std::move(other.alloc_);
+		take_storage(other);
+	}
+
+	void move_assign(matrix& other, std::false_type)
+	{
+		if (alloc_ == other.alloc_) {
+			deallocate();
+			take_storage(other);
+			return;
 		}
+		// the storage of 'other' cannot be released by our allocator, move the elements instead
+		padded_ = other.padded_;
+		reshape(other.rows_, other.cols_, other.stride_);
+		for (size_t i = 0; i < rows_; ++i)
+			std::move(other.data_ + i * stride_, other.data_ + i * stride_ + cols_, data_ + i * stride_);
+	}
+
+	void take_storage(matrix& other)
+	{
+		data_ = other.data_;
+		capacity_ = other.capacity_;
+		rows_ = other.rows_;
+		cols_ = other.cols_;
+		stride_ = other.stride_;
+		padded_ = other.padded_;
+		other.release();
+	}
+
+	void init(T value) {
+		for (size_t i = 0; i < rows_; ++i)
+			std::fill(data_ + i * stride_, data_ + i * stride_ + cols_, value);
 	}
 
 	T* data_ = nullptr;
+	size_t capacity_ = 0;
 	size_t rows_ = 0;
 	size_t cols_ = 0;
+	size_t stride_ = 0;
+	bool padded_ = false;
+	Allocator alloc_;
 };
 
 
 
-template<typename T>
-struct type_to_regexp<matrix<T>>
+template<typename T, size_t Alignment, typename Allocator>
+struct expression_operand<matrix<T, Alignment, Allocator>>
+{
+	static const bool value = true;
+	typedef array_expression<T, 2> type;
+	static type make(const matrix<T, Alignment, Allocator>& m) { return type(m.data(), m.rows(), m.cols(), m.stride()); }
+};
+
+template<typename T, size_t Alignment, typename Allocator>
+struct type_to_regexp<matrix<T, Alignment, Allocator>>
 {
 	static const std::string& exp_str();
 };
-template<typename T>
-const std::string& type_to_regexp<matrix<T>>::exp_str()
+template<typename T, size_t Alignment, typename Allocator>
+const std::string& type_to_regexp<matrix<T, Alignment, Allocator>>::exp_str()
 {
 	static const std::string& value { make_braced_list(make_braced_list(type_to_regexp<T>::exp_str())) };
 	return value;
 };
 
+/**
+ * Parses the rows directly into the storage of the matrix: the first row determines cols(), the
+ * following ones are parsed in place while the storage grows geometrically.
+ */
+template<typename T, size_t Alignment, typename Allocator>
+struct type_to_parser<matrix<T, Alignment, Allocator>>
+{
+	typedef braced_list_parser<type_to_parser<T>> row_parser;
+
+	template<typename Scanner>
+	static bool parse(Scanner& s, matrix<T, Alignment, Allocator>& m)
+	{
+		std::vector<T> first_row;
+		if (!s.consume('{') || !row_parser::parse(s, first_row))
+			return false;
+		m.resize(1, first_row.size());
+		std::move(first_row.begin(), first_row.end(), m.data());
+
+		bool equal_cols = true;
+		while (s.consume(',')) {
+			const size_t rows = m.rows();
+			if ((rows + 1) * m.stride() > m.capacity())
+				m.reserve_rows(std::max(2 * rows, min_rows));
+			m.resize(rows + 1, m.cols());
+			if (!parse_row(s, m, rows, equal_cols))
+				return false;
+		}
+		if (!s.consume('}'))
+			return false;
+
+		check_cols(equal_cols);
+		DEBUG_ONLY( std::cout << "Parsed matrix size: " << m.rows() << " x " << m.cols() << std::endl; )
+		return true;
+	}
+
+	/**
+	 * Parse a row into row 'i' of 'm'. Surplus entries are parsed, but dropped, 'equal_cols' is
+	 * cleared if the length differs from cols().
+	 */
+	template<typename Scanner>
+	static bool parse_row(Scanner& s, matrix<T, Alignment, Allocator>& m, size_t i, bool& equal_cols)
+	{
+		T* row = &m.at(i, 0);
+		const size_t cols = m.cols();
+		size_t j = 0;
+		T surplus;
+		const bool valid = row_parser::parse_into(s, [&]() -> T& {
+			++j;
+			return (j <= cols) ? row[j - 1] : surplus;
+		});
+		equal_cols = equal_cols && (j == cols);
+		return valid;
+	}
+
+	static void check_cols(bool equal_cols)
+	{
+		if (!equal_cols)
+			throw parser_error("noma::typa::matrix<T>::operator>>(): error: rows have differing lengths, check your input list.");
+	}
+
+	static const size_t min_rows = 16;
+};
+
+template<typename T, size_t Alignment, typename Allocator>
+struct string_to_value<matrix<T, Alignment, Allocator>>
+{
+	typedef type_to_parser<matrix<T, Alignment, Allocator>> parser;
+
+	static matrix<T, Alignment, Allocator> parse(const std::string& input)
+	{
+		return parse(input.data(), input.data() + input.size());
+	}
+
+	static matrix<T, Alignment, Allocator> parse(const char* first, const char* last)
+	{
+		NOMA_TYPA_STATS_CALL("noma::typa::string_to_value<matrix<T>>::parse()");
+		matrix<T, Alignment, Allocator> result;
+		std::atomic<bool> equal_cols { true };
+
+		// large inputs: rows are parsed in parallel, the first one determines the number of columns
+		auto resize = [&](size_t rows) {
+			std::vector<T> first_row;
+			scanner s(first, last);
+			if (!s.consume('{') || !parser::row_parser::parse(s, first_row))
+				return false; // reported by the serial parser
+			result.resize(rows, first_row.size());
+			return true;
+		};
+		auto parse_rows = [&](scanner& s, size_t offset, size_t count) {
+			bool valid = true;
+			bool chunk_equal_cols = true;
+			for (size_t i = 0; valid && i < count; ++i)
+				valid = (i == 0 || s.consume(',')) && parser::parse_row(s, result, offset + i, chunk_equal_cols);
+			if (!chunk_equal_cols)
+				equal_cols = false;
+			return valid;
+		};
+
+		bool valid = true;
+		const char* error_position = first;
+		if (!detail::parallel_parse_braced_list(first, last, std::false_type(), resize, parse_rows))
+			valid = parse_whole<parser>(first, last, result, error_position);
+		if (!valid)
+			throw parser_error("noma::typa::matrix<T>::operator>>(): error: malformed input at offset " + std::to_string(error_position - first) + ", should be a braced list of braced lists, e.g. {{ T, T, ..}, ..}.");
+		parser::check_cols(equal_cols);
+		return result;
+	}
+};
+
 // output function
-template<typename T>
-std::ostream& operator<<(std::ostream& out, const matrix<T>& m)
+template<typename T, size_t Alignment, typename Allocator>
+std::ostream& operator<<(std::ostream& out, const matrix<T, Alignment, Allocator>& m)
 {
 	m.print(out);
 
@@ -222,58 +676,46 @@ std::ostream& operator<<(std::ostream& out, const matrix<T>& m)
 }
 
 // parser/input function
-template<typename T>
-std::istream& operator>>(std::istream& in, matrix<T>& m)
+template<typename T, size_t Alignment, typename Allocator>
+std::istream& operator>>(std::istream& in, matrix<T, Alignment, Allocator>& m)
 {
-	std::string line;
-	std::getline(in, line);
-	bool is_list = line.front() == '{'; // TODO: maybe do a smarter test here
+	NOMA_TYPA_STATS_CALL("noma::typa::matrix<T>::operator>>()");
+	bool is_list = in.peek() == '{'; // TODO: maybe do a smarter test here
 	DEBUG_ONLY( std::cout << "Parsing matrix using protocol: " << (is_list ? "list" : "file") << std::endl; )
 	if (is_list)
 	{
-		std::string& list = line;
-		DEBUG_ONLY( std::cout << "Parsing matrix from list: " << list << std::endl; )
-		std::vector<std::vector<T>> row_vec = noma::typa::parse_braced_list<std::vector<T>>(list);
-
-		size_t rows = row_vec.size();
-		size_t cols = row_vec[0].size();
-		// check if all rows have equal size
-		bool cols_equal = true;
-		for (auto& row : row_vec)
-			cols_equal = cols_equal && (row.size() == cols);
-
-		if(!cols_equal)
-			throw parser_error("noma::typa::matrix<T>::operator>>(): error: rows have differing lengths, check your input list.");
-		DEBUG_ONLY( std::cout << "Parsed matrix size: " << rows << " x " << cols << std::endl; )
-		// fill matrix
-		m.resize(rows, cols);
-		for (size_t i = 0; i < rows; ++i) {
-			for (size_t j = 0; j < cols; ++j) {
-				m.at(i, j) = row_vec[i][j];
-			}
-		}
+		// parsed while reading, the list is never held in memory as a whole
+		if (!parse_stream<type_to_parser<matrix<T, Alignment, Allocator>>>(in, m))
+			throw parser_error("noma::typa::matrix<T>::operator>>(): error: malformed input, should be a braced list of braced lists, e.g. {{ T, T, ..}, ..}.");
 		DEBUG_ONLY( std::cout << "Parsed matrix from list: " << m << std::endl; )
 	}
 	else // handle as file name
 	{
-		std::string& filename = line;
+		std::string filename;
+		std::getline(in, filename);
 		DEBUG_ONLY( std::cout << "Parsing matrix from file: " << filename << std::endl; )
-		std::ifstream fs(filename);
-		if (fs.fail())
-			throw parser_error("noma::typa::matrix<T>::operator>>(): error: could not open file '" + filename + "'.");
-		size_t rows, cols;
-		fs >> rows >> cols;
-		m.resize(rows, cols);
-		for (size_t i = 0; i < rows; ++i) {
-			for (size_t j = 0; j < cols; ++j) {
-				fs >> m.at(i, j);
-			}
+		if (is_npy_filename(filename)) {
+			m.load_npy(filename);
+			return in;
 		}
+		text_file file(filename);
+		const std::vector<size_t> extents = file.read_extents(2); // rows, cols
+		m.resize(extents[0], extents[1]);
+		file.read_values(m.data(), m.rows() * m.cols(), m.cols(), m.stride());
 	}
 
 	return in;
 }
 
+template<typename T, size_t Alignment, typename Allocator>
+const size_t matrix<T, Alignment, Allocator>::alignment;
+
+template<typename T, size_t Alignment, typename Allocator>
+const size_t matrix<T, Alignment, Allocator>::transpose_tile_size;
+
+template<typename T, size_t Alignment, typename Allocator>
+const size_t type_to_parser<matrix<T, Alignment, Allocator>>::min_rows;
+
 } // namespace typa
 } // namespace noma
 
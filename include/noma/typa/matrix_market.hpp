@@ -0,0 +1,193 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_matrix_market_hpp
+#define noma_typa_matrix_market_hpp
+
+#include <complex>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "noma/typa/mapped_file.hpp"
+#include "noma/typa/parallel.hpp"
+#include "noma/typa/parser_error.hpp"
+#include "noma/typa/text_file.hpp"
+#include "noma/typa/util.hpp"
+
+namespace noma {
+namespace typa {
+
+/**
+ * Support for the Matrix Market exchange format (.mtx), coordinate variant, used by the file protocol
+ * of sparse_matrix for file names ending in ".mtx".
+ * See: https://math.nist.gov/MatrixMarket/formats.html
+ */
+
+/**
+ * Nonzero entry of a sparse matrix in coordinate form, 0-based.
+ */
+template<typename T>
+struct sparse_entry
+{
+	size_t row;
+	size_t col;
+	T value;
+};
+
+enum class mtx_field { real, integer, complex, pattern };
+enum class mtx_symmetry { general, symmetric, skew_symmetric, hermitian };
+
+/**
+ * Returns true if 'filename' ends with ".mtx".
+ */
+bool is_mtx_filename(const std::string& filename);
+
+namespace detail {
+
+/**
+ * Set part 'part' (0: real, 1: imaginary) of 'value' from the token [first, last).
+ */
+template<typename T>
+void set_mtx_value(T& value, size_t, const char* first, const char* last)
+{
+	value = typa::parse_value<T>(first, last);
+}
+
+template<typename T>
+void set_mtx_value(std::complex<T>& value, size_t part, const char* first, const char* last)
+{
+	if (part == 0)
+		value.real(typa::parse_value<T>(first, last));
+	else
+		value.imag(typa::parse_value<T>(first, last));
+}
+
+template<typename T>
+struct is_complex : std::false_type
+{
+};
+
+template<typename T>
+struct is_complex<std::complex<T>> : std::true_type
+{
+};
+
+} // namespace detail
+
+/**
+ * Read-only view of a .mtx file in coordinate format: the header, i.e. the banner
+ * "%%MatrixMarket matrix coordinate <field> <symmetry>", comment lines and the size line
+ * "rows cols entries", is parsed on construction. The entries are converted by read_entries(), in
+ * parallel for large files like text_file.
+ * Throws parser_error if the file cannot be opened or has an invalid or unsupported header, which
+ * includes more entries than fit into the rest of the file.
+ */
+class matrix_market_file
+{
+public:
+	explicit matrix_market_file(const std::string& filename);
+
+	matrix_market_file(const matrix_market_file&) = delete;
+	matrix_market_file& operator=(const matrix_market_file&) = delete;
+
+	size_t rows() const { return rows_; }
+	size_t cols() const { return cols_; }
+
+	/**
+	 * Number of entries stored in the file, for symmetric files only the lower triangle.
+	 */
+	size_t entries() const { return entries_; }
+
+	mtx_field field() const { return field_; }
+	mtx_symmetry symmetry() const { return symmetry_; }
+
+	/**
+	 * Convert the entries() entries into 'entries', 0-based. Entries of a pattern file have the
+	 * value 1. The mirrored entries of symmetric files are not added, cf. sparse_matrix::load_mtx().
+	 * Throws parser_error on malformed entries, out of range indices, or a wrong number of entries.
+	 */
+	template<typename T>
+	void read_entries(sparse_entry<T>* entries)
+	{
+		if (field_ == mtx_field::complex && !detail::is_complex<T>::value)
+			throw parser_error("noma::typa::matrix_market_file::read_entries(): error: '" + filename_ + "' has complex entries, the element type is not std::complex.");
+		const size_t tokens_per_entry = this->tokens_per_entry();
+
+		const char* first = position_;
+		const char* last = file_.end();
+		const size_t parts = (static_cast<size_t>(last - first) >= parallel_min_input_size) ? thread_count() : 1;
+		const std::vector<detail::text_range> ranges = detail::split_at_whitespace(first, last, parts);
+
+		// count first, so that every part knows which entry its first token belongs to
+		std::vector<size_t> offsets(ranges.size() + 1, 0);
+		parallel_for(ranges.size(), [&](size_t i) {
+			NOMA_TYPA_STATS_PHASE(validation, ranges[i].second - ranges[i].first);
+			offsets[i + 1] = detail::count_tokens(ranges[i].first, ranges[i].second);
+		});
+		for (size_t i = 0; i < ranges.size(); ++i)
+			offsets[i + 1] += offsets[i];
+		if (offsets.back() != entries_ * tokens_per_entry)
+			throw parser_error("noma::typa::matrix_market_file::read_entries(): error: '" + filename_ + "' contains " + std::to_string(offsets.back()) + " tokens, expected " + std::to_string(entries_) + " entries of " + std::to_string(tokens_per_entry) + ".");
+
+		// convert, the first offending token in file order is reported
+		std::vector<const char*> errors(ranges.size(), nullptr);
+		parallel_for(ranges.size(), [&](size_t i) {
+			NOMA_TYPA_STATS_PHASE(conversion, ranges[i].second - ranges[i].first);
+			size_t token = offsets[i];
+			const char* end = ranges[i].second;
+			for (const char* it = skip_whitespace(ranges[i].first, end); it != end; it = skip_whitespace(it, end), ++token) {
+				const char* token_last = detail::token_end(it, end);
+				sparse_entry<T>& entry = entries[token / tokens_per_entry];
+				const size_t field = token % tokens_per_entry;
+				try {
+					if (field < 2) {
+						const size_t index = parse_value<size_t>(it, token_last);
+						if (index == 0 || index > ((field == 0) ? rows_ : cols_)) {
+							errors[i] = it;
+							return;
+						}
+						(field == 0 ? entry.row : entry.col) = index - 1;
+						if (field == 1 && tokens_per_entry == 2)
+							entry.value = T(1);
+					} else {
+						detail::set_mtx_value(entry.value, field - 2, it, token_last);
+					}
+				} catch (boost::bad_lexical_cast&) {
+					errors[i] = it;
+					return;
+				}
+				it = token_last;
+			}
+		});
+		for (const char* error : errors)
+			if (error)
+				throw parser_error("noma::typa::matrix_market_file::read_entries(): error: invalid entry '" + std::string(error, detail::token_end(error, last)) + "' " + detail::text_location(filename_, file_.begin(), error) + ".");
+	}
+
+private:
+	void parse_header();
+
+	size_t tokens_per_entry() const
+	{
+		return (field_ == mtx_field::pattern) ? 2 : (field_ == mtx_field::complex) ? 4 : 3;
+	}
+
+	std::string filename_;
+	mapped_file file_;
+	const char* position_;
+	size_t rows_ = 0;
+	size_t cols_ = 0;
+	size_t entries_ = 0;
+	mtx_field field_ = mtx_field::real;
+	mtx_symmetry symmetry_ = mtx_symmetry::general;
+};
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_matrix_market_hpp
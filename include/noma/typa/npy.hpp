@@ -0,0 +1,136 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_npy_hpp
+#define noma_typa_npy_hpp
+
+#include <complex>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "noma/typa/mapped_file.hpp"
+#include "noma/typa/parser_error.hpp"
+
+namespace noma {
+namespace typa {
+
+/**
+ * Support for NumPy's binary .npy format (versions 1.0 to 3.0), used by the file protocol of
+ * vector and matrix for file names ending in ".npy".
+ * See: https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+ */
+
+/**
+ * Type trait providing the .npy type descriptor (NumPy dtype.str) for T, e.g. "<f8" for double on a
+ * little endian machine. Defined for arithmetic types and std::complex of float/double.
+ */
+template<typename T, typename Enable = void>
+struct npy_descr
+{
+};
+
+/**
+ * Byte order character of multi-byte types in native order: '<' or '>'.
+ */
+char npy_byte_order();
+
+template<typename T>
+struct npy_descr<T, typename std::enable_if<std::is_arithmetic<T>::value>::type>
+{
+	static std::string value()
+	{
+		const char kind = std::is_same<T, bool>::value ? 'b' : std::is_floating_point<T>::value ? 'f' : std::is_signed<T>::value ? 'i' : 'u';
+		return std::string(1, (sizeof(T) == 1) ? '|' : npy_byte_order()) + kind + std::to_string(sizeof(T));
+	}
+};
+
+template<typename T>
+struct npy_descr<std::complex<T>, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+	static std::string value()
+	{
+		return std::string(1, npy_byte_order()) + 'c' + std::to_string(sizeof(std::complex<T>));
+	}
+};
+
+namespace detail {
+
+// npy_descr<T>::value() if defined, otherwise T cannot be stored in .npy files (run time error)
+template<typename T>
+auto npy_descr_value(int) -> decltype(npy_descr<T>::value())
+{
+	return npy_descr<T>::value();
+}
+
+template<typename T>
+std::string npy_descr_value(long)
+{
+	throw parser_error("noma::typa::npy_descr_value(): error: element type not supported by the .npy format.");
+}
+
+} // namespace detail
+
+/**
+ * Returns true if 'filename' ends with ".npy".
+ */
+bool is_npy_filename(const std::string& filename);
+
+/**
+ * Read-only view of a .npy file. The file is memory mapped where supported (see mapped_file), so
+ * the payload is not read before it is accessed.
+ * Throws parser_error if the file cannot be opened or has an invalid header.
+ */
+class npy_file
+{
+public:
+	explicit npy_file(const std::string& filename);
+
+	npy_file(const npy_file&) = delete;
+	npy_file& operator=(const npy_file&) = delete;
+
+	const std::string& descr() const { return descr_; }
+	bool fortran_order() const { return fortran_order_; }
+	const std::vector<size_t>& shape() const { return shape_; }
+
+	/**
+	 * Pointer to the payload after validating that it holds a 'dimensions' dimensional array of T.
+	 * Throws parser_error otherwise, or if T has no npy_descr.
+	 * NOTE: The pointer might not be aligned for T, copy the payload (e.g. with memcpy()).
+	 */
+	template<typename T>
+	const char* payload(size_t dimensions) const
+	{
+		check_payload(detail::npy_descr_value<T>(0), sizeof(T), dimensions);
+		return data_ + payload_offset_;
+	}
+
+private:
+	void parse_header();
+	void check_payload(const std::string& descr, size_t element_size, size_t dimensions) const;
+
+	std::string filename_;
+	mapped_file file_;
+	const char* data_;
+	size_t size_;
+	std::string descr_;
+	bool fortran_order_ = false;
+	std::vector<size_t> shape_;
+	size_t payload_offset_ = 0;
+};
+
+/**
+ * Write a C order array with the given type descriptor and shape to 'filename' in .npy format
+ * (version 1.0 if possible). 'data' holds the elements, 'size' bytes.
+ * A non-zero 'row_stride' is the distance in bytes between the beginnings of consecutive rows (along the
+ * first dimension) in 'data', e.g. for a matrix with padded rows, 'size' excludes the padding.
+ * Throws parser_error if the file cannot be written.
+ */
+void write_npy(const std::string& filename, const std::string& descr, const std::vector<size_t>& shape, const void* data, size_t size, size_t row_stride = 0);
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_npy_hpp
@@ -0,0 +1,103 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_number_hpp
+#define noma_typa_number_hpp
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace noma {
+namespace typa {
+
+/**
+ * Locale independent conversion of numeric literals, used by the string_to_value specialisations
+ * for arithmetic types in basic_types.hpp instead of boost::lexical_cast.
+ * All functions return false for anything they do not convert exactly like boost::lexical_cast,
+ * i.e. malformed input, out of range values and (for reals) zero, subnormal, infinite or hard to
+ * round results. The callers then fall back to boost::lexical_cast, which either produces the
+ * same value or throws the same exception as before.
+ */
+
+/**
+ * Convert a real literal, i.e. [-+]?(?:[0-9]*\.?[0-9]+|[0-9]+\.)(?:[eE][-+]?[0-9]+)?, to the nearest
+ * double/float (round half to even), with Clinger's fast path and the Eisel-Lemire algorithm.
+ */
+bool parse_real_literal(const char* first, const char* last, double& value);
+bool parse_real_literal(const char* first, const char* last, float& value);
+
+/**
+ * Convert a non-empty sequence of decimal digits that fits into 64 bits.
+ */
+bool parse_unsigned_digits(const char* first, const char* last, uint64_t& value);
+
+/**
+ * Convert an integer literal, i.e. [-+]?[0-9]+, to T.
+ * Like boost::lexical_cast, negative values are accepted for unsigned types and wrap around, as
+ * long as their magnitude is in range.
+ */
+template<typename T>
+bool parse_integer_literal(const char* first, const char* last, T& value)
+{
+	static_assert(std::is_integral<T>::value && sizeof(T) <= sizeof(uint64_t), "parse_integer_literal() requires an integral type");
+	typedef typename std::make_unsigned<T>::type unsigned_type;
+
+	bool negative = false;
+	if (first != last && (*first == '-' || *first == '+')) {
+		negative = *first == '-';
+		++first;
+	}
+	uint64_t magnitude;
+	if (first == last || !parse_unsigned_digits(first, last, magnitude))
+		return false;
+
+	// largest magnitude representable
+	uint64_t limit = static_cast<unsigned_type>(std::numeric_limits<unsigned_type>::max());
+	if (std::is_signed<T>::value)
+		limit = static_cast<uint64_t>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+	if (magnitude > limit)
+		return false;
+
+	const unsigned_type bits = static_cast<unsigned_type>(magnitude);
+	value = static_cast<T>(negative ? static_cast<unsigned_type>(unsigned_type(0) - bits) : bits);
+	return true;
+}
+
+/**
+ * Arithmetic types converted with the functions above, bool and the character types keep using
+ * boost::lexical_cast, which treats them differently.
+ */
+template<typename T>
+struct is_fast_number : std::integral_constant<bool,
+	(std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value
+	 && !std::is_same<T, signed char>::value && !std::is_same<T, unsigned char>::value
+	 && !std::is_same<T, wchar_t>::value && !std::is_same<T, char16_t>::value && !std::is_same<T, char32_t>::value)
+	|| std::is_same<T, double>::value || std::is_same<T, float>::value>
+{
+};
+
+/**
+ * Overload set used by the string_to_value specialisations.
+ */
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value, bool>::type parse_number(const char* first, const char* last, T& value)
+{
+	return parse_integer_literal(first, last, value);
+}
+
+inline bool parse_number(const char* first, const char* last, double& value)
+{
+	return parse_real_literal(first, last, value);
+}
+
+inline bool parse_number(const char* first, const char* last, float& value)
+{
+	return parse_real_literal(first, last, value);
+}
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_number_hpp
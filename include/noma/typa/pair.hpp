@@ -6,11 +6,11 @@
 #define noma_typa_pair_hpp
 
 #include <iostream>
-#include <regex>
 #include <string>
 #include <utility>
 
 #include "noma/typa/parser_error.hpp"
+#include "noma/typa/parser.hpp"
 #include "noma/typa/util.hpp"
 
 namespace noma {
@@ -26,31 +26,38 @@ std::string make_pair(const std::string& first_exp, const std::string& second_ex
 /**
  * Parse a pair into a std::pair for an entry types T1 and T2.
  * Input Format: "(T1, T2)"
+ * The input range [first, last) is neither copied nor modified, whitespace is skipped while parsing.
  */
 template<typename T1, typename T2>
-std::pair<T1, T2> parse_pair(const std::string& input)
+std::pair<T1, T2> parse_pair(const char* first, const char* last)
 {
-	const std::string input_no_ws { remove_whitespace(input) };
-	const std::regex first_exp { type_to_regexp<T1>::exp_str() };
-	const std::regex second_exp { type_to_regexp<T2>::exp_str() };
-	const std::regex pair_exp { make_pair(type_to_regexp<T1>::exp_str(), type_to_regexp<T2>::exp_str()) };
+	NOMA_TYPA_STATS_CALL("noma::typa::parse_pair()");
+	std::pair<T1, T2> result;
 
-	// check format
-	if(!std::regex_match(input_no_ws, pair_exp))
+	// validate and extract in one pass
+	if (!parse_whole<pair_parser<type_to_parser<T1>, type_to_parser<T2>>>(first, last, result))
 		throw parser_error("noma::typa::parse_pair(): error: malformed input, should be comma separated pair, e.g. (T1, T2).");
 
-	std::pair<T1, T2> result;
+	return result;
+}
+
+template<typename T1, typename T2>
+std::pair<T1, T2> parse_pair(const std::string& input)
+{
+	return parse_pair<T1, T2>(input.data(), input.data() + input.size());
+}
 
-	std::smatch sm;
-	std::string::const_iterator cit = input_no_ws.cbegin();
+/**
+ * Parse a pair from the current line of 'in', see parse_braced_list(std::istream&).
+ */
+template<typename T1, typename T2>
+std::pair<T1, T2> parse_pair(std::istream& in)
+{
+	NOMA_TYPA_STATS_CALL("noma::typa::parse_pair()");
+	std::pair<T1, T2> result;
 
-	// parse first
-	std::regex_search(cit, input_no_ws.cend(), sm, first_exp);
-	result.first = string_to_value<T1>::parse(sm[0].str());
-	cit = sm[0].second;
-	// parse second
-	std::regex_search(cit, input_no_ws.cend(), sm, second_exp);
-	result.second = string_to_value<T2>::parse(sm[0].str());
+	if (!parse_stream<pair_parser<type_to_parser<T1>, type_to_parser<T2>>>(in, result))
+		throw parser_error("noma::typa::parse_pair(): error: malformed input, should be comma separated pair, e.g. (T1, T2).");
 
 	return result;
 }
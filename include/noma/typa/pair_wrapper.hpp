@@ -31,11 +31,37 @@ const std::string& type_to_regexp<pair_wrapper<T1, T2>>::exp_str()
 	return value;
 };
 
+template<typename T1, typename T2>
+struct type_to_parser<pair_wrapper<T1, T2>>
+{
+	template<typename Scanner>
+	static bool parse(Scanner& s, pair_wrapper<T1, T2>& p)
+	{
+		return pair_parser<type_to_parser<T1>, type_to_parser<T2>>::parse(s, p.get());
+	}
+};
+
+// Output Format: "(T1, T2)"
+template<typename T1, typename T2>
+struct value_formatter<pair_wrapper<T1, T2>>
+{
+	static void format(format_buffer& out, const pair_wrapper<T1, T2>& p)
+	{
+		out.append('(');
+		out.append_value(p.get().first);
+		out.append(", ", 2);
+		out.append_value(p.get().second);
+		out.append(')');
+	}
+};
+
 template<typename T1, typename T2>
 std::ostream& operator<<(std::ostream& out, const pair_wrapper<T1, T2>& p)
 {
 	//std::cout << "printing pair_wrapper" << std::endl;
-	out << '(' << p.get().first << ", " << p.get().second << ')';
+	format_buffer buffer(out);
+	buffer.append_value(p);
+	buffer.write_to(out);
 	return out;
 }
 
@@ -43,11 +69,7 @@ template<typename T1, typename T2>
 std::istream& operator>>(std::istream& in, pair_wrapper<T1, T2>& p)
 {
 	//std::cout << "parsing pair_wrapper" << std::endl;
-	std::string value;
-	std::getline(in, value);
-
-	// parse
-	p.get() = parse_pair<T1, T2>(value);
+	p.get() = parse_pair<T1, T2>(in);
 
 	return in;
 }
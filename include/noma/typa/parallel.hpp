@@ -0,0 +1,79 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_parallel_hpp
+#define noma_typa_parallel_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace noma {
+namespace typa {
+
+/**
+ * Number of threads used by the parallel parts of the library, e.g. parse_braced_list() for large
+ * inputs. The default is 1, i.e. everything runs on the calling thread.
+ */
+size_t thread_count();
+
+/**
+ * Set the value returned by thread_count(), 0 selects std::thread::hardware_concurrency().
+ */
+void set_thread_count(size_t count);
+
+/**
+ * Inputs (or data) smaller than this are always processed serially, as starting threads does not
+ * pay off.
+ */
+const size_t parallel_min_input_size = 1024 * 1024;
+
+/**
+ * Call 'func(i)' for every i in [0, count) using up to thread_count() threads, including the calling
+ * one. Tasks are handed out in order. If tasks throw, the exception of the task with the lowest index
+ * is rethrown after all threads finished, independently of the scheduling.
+ * If threads cannot be started, the tasks are done by those that could, at least the calling one.
+ */
+template<typename F>
+void parallel_for(size_t count, F func)
+{
+	std::vector<std::exception_ptr> errors(count);
+	std::atomic<size_t> next { 0 };
+	auto worker = [&]() {
+		for (size_t i = next++; i < count; i = next++) {
+			try {
+				func(i);
+			} catch (...) {
+				errors[i] = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	const size_t helper_count = std::min(thread_count(), count) - (count > 0 ? 1 : 0);
+	threads.reserve(helper_count);
+	for (size_t t = 0; t < helper_count; ++t) {
+		try {
+			threads.emplace_back(worker);
+		} catch (std::system_error&) {
+			break; // out of threads: the running ones and the calling thread do the remaining tasks
+		}
+	}
+	worker();
+	for (auto& t : threads)
+		t.join();
+
+	for (auto& e : errors)
+		if (e)
+			std::rethrow_exception(e);
+}
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_parallel_hpp
@@ -0,0 +1,300 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_parser_hpp
+#define noma_typa_parser_hpp
+
+#include <algorithm>
+#include <istream>
+#include <iterator>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "noma/typa/scanner.hpp"
+#include "noma/typa/stream_scanner.hpp"
+#include "noma/typa/util.hpp"
+
+namespace noma {
+namespace typa {
+
+/**
+ * Parser combinators mirroring the regular expression builders (make_braced_list(), make_pair()).
+ * Every parser is a type with a static member function
+ *     template<typename Scanner, typename T> static bool parse(Scanner& s, T& value);
+ * which parses a T at the current position of 's', advances behind it and returns true, or returns
+ * false on malformed input. Scanner is either scanner (scanner.hpp), for inputs in memory, or
+ * stream_scanner (stream_scanner.hpp), for inputs read from a std::istream while parsing. Composing them via type_to_parser yields a specialised parser for
+ * every (nested) type at compile time, no grammar strings are built at run time.
+ */
+
+/**
+ * Convert a token matched by the scanner with string_to_value<T>. Only tokens that contain
+ * whitespace, which the scanner steps over, are copied to remove it.
+ */
+template<typename T>
+T parse_token(const char* first, const char* last)
+{
+	NOMA_TYPA_STATS_PHASE(conversion, last - first);
+	if (std::find_if(first, last, is_space) == last)
+		return parse_value<T>(first, last);
+
+	std::string token { first, last };
+	return string_to_value<T>::parse(remove_whitespace(token));
+}
+
+/**
+ * Leaf parser: match a literal with a recogniser from scanner.hpp and convert it with string_to_value<T>.
+ */
+template<typename Recogniser>
+struct literal_parser
+{
+	template<typename Scanner, typename T>
+	static bool parse(Scanner& s, T& value)
+	{
+		const char* first;
+		const char* last;
+		if (!s.token(Recogniser(), first, last))
+			return false;
+		value = parse_token<T>(first, last);
+		return true;
+	}
+};
+
+/**
+ * Braced, comma separated list of entries parsed by EntryParser, cf. make_braced_list().
+ * Input Format: "{T,T,...}"
+ */
+template<typename EntryParser>
+struct braced_list_parser
+{
+	template<typename Scanner, typename T>
+	static bool parse(Scanner& s, std::vector<T>& values)
+	{
+		values.clear();
+		return parse_into(s, [&]() -> T& {
+			NOMA_TYPA_STATS_ONLY( const size_t capacity = values.capacity(); )
+			values.emplace_back();
+			NOMA_TYPA_STATS_ONLY( if (values.capacity() != capacity) NOMA_TYPA_STATS_ALLOCATION(values.capacity() * sizeof(T)); )
+			return values.back();
+		});
+	}
+
+	/**
+	 * Parse the list with every entry parsed into the T& returned by 'next()', i.e. directly into the
+	 * final storage of a container, e.g. vector and matrix.
+	 */
+	template<typename Scanner, typename Next>
+	static bool parse_into(Scanner& s, Next next)
+	{
+		if (!s.consume('{'))
+			return false;
+		do {
+			if (!EntryParser::parse(s, next()))
+				return false;
+		} while (s.consume(','));
+		return s.consume('}');
+	}
+};
+
+/**
+ * Nesting of std::vector in V: 'depth' levels of lists around entries of type 'leaf', e.g. 3 and
+ * double for std::vector<std::vector<std::vector<double>>>.
+ */
+template<typename V>
+struct list_nesting
+{
+	typedef V leaf;
+	static const size_t depth = 0;
+};
+
+template<typename T>
+struct list_nesting<std::vector<T>>
+{
+	typedef typename list_nesting<T>::leaf leaf;
+	static const size_t depth = list_nesting<T>::depth + 1;
+};
+
+/**
+ * Braced lists of braced lists of leaves parsed by LeafParser, e.g. into
+ * std::vector<std::vector<std::vector<double>>>, cf. braced_list_parser. Parsed in a single loop
+ * with an explicit stack of the open lists instead of one (recursive) parser per level: leaves go
+ * into a flat array, and the number of entries of every list is recorded per level. The result is
+ * built from these with exactly one allocation per list.
+ */
+template<typename LeafParser>
+struct nested_list_parser
+{
+	template<typename Scanner, typename V>
+	static bool parse(Scanner& s, V& value)
+	{
+		typedef typename list_nesting<V>::leaf leaf;
+		const size_t depth = list_nesting<V>::depth;
+
+		std::vector<leaf> leaves;
+		std::vector<size_t> counts[depth]; // entries of every closed list, in closing order per level
+		size_t open_counts[depth]; // entries of the open list per level
+		size_t level = 0;
+		open_counts[0] = 0;
+		if (!s.consume('{'))
+			return false;
+		while (true) {
+			// every entry above the innermost level is a list
+			while (level + 1 < depth) {
+				if (!s.consume('{'))
+					return false;
+				open_counts[++level] = 0;
+			}
+			NOMA_TYPA_STATS_ONLY( const size_t capacity = leaves.capacity(); )
+			leaves.emplace_back();
+			NOMA_TYPA_STATS_ONLY( if (leaves.capacity() != capacity) NOMA_TYPA_STATS_ALLOCATION(leaves.capacity() * sizeof(leaf)); )
+			if (!LeafParser::parse(s, leaves.back()))
+				return false;
+
+			// close finished lists, up to the one continued with a ','
+			while (true) {
+				++open_counts[level];
+				if (s.consume(','))
+					break;
+				if (!s.consume('}'))
+					return false;
+				counts[level].push_back(open_counts[level]);
+				if (level == 0) {
+					size_t positions[depth] = { };
+					size_t leaf_position = 0;
+					build(value, 0, counts, positions, leaves, leaf_position);
+					return true;
+				}
+				--level;
+			}
+		}
+	}
+
+private:
+	// lists of lists: the counts of 'level' are in the same order as the lists are built
+	template<typename T, typename Leaf>
+	static void build(std::vector<std::vector<T>>& value, size_t level, const std::vector<size_t>* counts, size_t* positions, std::vector<Leaf>& leaves, size_t& leaf_position)
+	{
+		value.resize(counts[level][positions[level]++]);
+		for (auto& entry : value)
+			build(entry, level + 1, counts, positions, leaves, leaf_position);
+	}
+
+	// innermost lists
+	template<typename Leaf>
+	static void build(std::vector<Leaf>& value, size_t level, const std::vector<size_t>* counts, size_t* positions, std::vector<Leaf>& leaves, size_t& leaf_position)
+	{
+		const size_t count = counts[level][positions[level]++];
+		value.assign(std::make_move_iterator(leaves.begin() + leaf_position), std::make_move_iterator(leaves.begin() + leaf_position + count));
+		leaf_position += count;
+	}
+};
+
+/**
+ * Pair of entries parsed by FirstParser and SecondParser, cf. make_pair().
+ * Input Format: "(T1,T2)"
+ */
+template<typename FirstParser, typename SecondParser>
+struct pair_parser
+{
+	template<typename Scanner, typename T1, typename T2>
+	static bool parse(Scanner& s, std::pair<T1, T2>& value)
+	{
+		return s.consume('(')
+		    && FirstParser::parse(s, value.first)
+		    && s.consume(',')
+		    && SecondParser::parse(s, value.second)
+		    && s.consume(')');
+	}
+};
+
+/**
+ * Recogniser using the cached compiled_regexp<T>, used by the default type_to_parser.
+ */
+template<typename T>
+struct regexp_recogniser
+{
+	static const bool plain = false;
+	template<typename It>
+	It operator()(It first, It last) const
+	{
+		std::match_results<It> m;
+		if (std::regex_search(first, last, m, compiled_regexp<T>::get(), std::regex_constants::match_continuous))
+			return m[0].second;
+		return first;
+	}
+};
+
+/**
+ * Type trait selecting the parser for a type T.
+ * Specialised next to the corresponding type_to_regexp specialisation. The default matches
+ * type_to_regexp<T> at the current position and converts with string_to_value<T>, so types that
+ * only specialise type_to_regexp keep working.
+ */
+template<typename T, typename Enable = void>
+struct type_to_parser : literal_parser<regexp_recogniser<T>>
+{
+};
+
+/**
+ * Parse the whole input [first, last) with Parser. Returns false on malformed input, with
+ * 'error_position' set to where parsing stopped.
+ */
+template<typename Parser, typename T>
+bool parse_whole(const char* first, const char* last, T& value, const char*& error_position)
+{
+	NOMA_TYPA_STATS_PHASE(extraction, last - first);
+	if (static_cast<size_t>(last - first) >= structural_index::min_input_size) {
+		structural_index index(first, last);
+		scanner s(first, last, &index);
+		const bool valid = Parser::parse(s, value) && s.at_end();
+		error_position = s.position();
+		return valid;
+	}
+
+	scanner s(first, last);
+	const bool valid = Parser::parse(s, value) && s.at_end();
+	error_position = s.position();
+	return valid;
+}
+
+template<typename Parser, typename T>
+bool parse_whole(const char* first, const char* last, T& value)
+{
+	const char* error_position;
+	return parse_whole<Parser>(first, last, value, error_position);
+}
+
+template<typename Parser, typename T>
+bool parse_whole(const std::string& input, T& value)
+{
+	return parse_whole<Parser>(input.data(), input.data() + input.size(), value);
+}
+
+/**
+ * Parse the current line of 'in' with Parser, reading it in chunks while parsing (see stream_scanner).
+ * Returns false on malformed input, the rest of the line is discarded then, as well as if Parser
+ * throws, e.g. a parser_error for a value out of range.
+ */
+template<typename Parser, typename T>
+bool parse_stream(std::istream& in, T& value)
+{
+	NOMA_TYPA_STATS_PHASE(extraction, 0);
+	stream_scanner s(in);
+	try {
+		if (Parser::parse(s, value) && s.at_end())
+			return true;
+	} catch (...) {
+		s.skip_rest();
+		throw;
+	}
+	s.skip_rest();
+	return false;
+}
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_parser_hpp
@@ -24,12 +24,16 @@ namespace typa {
  * Parser exception type to propagate parsing errors.
  * This implementation is compatible with boost program options which
  * catches bad_lexical_cast, but sadly, doesn't allow to transport a
- * custom message.
+ * custom message. The message is still available via what().
  */
 class parser_error : public boost::bad_lexical_cast
 {
 public:
-	parser_error(const std::string& msg) {};// : runtime_error(msg) { };
+	parser_error(const std::string& msg) : msg_(msg) { };
+
+	const char* what() const noexcept override { return msg_.c_str(); }
+private:
+	std::string msg_;
 };
 
 } // namespace typa
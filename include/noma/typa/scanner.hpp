@@ -0,0 +1,297 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_scanner_hpp
+#define noma_typa_scanner_hpp
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+
+#include "noma/typa/structural_index.hpp"
+#include "noma/typa/util.hpp"
+
+namespace noma {
+namespace typa {
+
+/**
+ * Hand-written recognisers for the literal grammars described in basic_types.hpp.
+ * Each returns an iterator past the longest match starting at 'first', or 'first' if there is none.
+ * They never backtrack, i.e. the run time is linear in the length of the match.
+ * NOTE: Defined in the header, so that they are inlined into the parsers generated from type_to_parser.
+ * NOTE: They work on any forward iterator over char, the scanner uses skip_whitespace_iterator
+ *       to make whitespace transparent, which is equivalent to calling remove_whitespace() first.
+ */
+namespace detail {
+
+template<typename It>
+It skip_digits(It first, It last)
+{
+	while (first != last && *first >= '0' && *first <= '9')
+		++first;
+	return first;
+}
+
+template<typename It>
+It skip_sign(It first, It last)
+{
+	if (first != last && (*first == '-' || *first == '+'))
+		++first;
+	return first;
+}
+
+} // namespace detail
+
+// grammar: [-+]?[0-9]+
+template<typename It>
+It scan_integer_literal(It first, It last)
+{
+	const It digits = detail::skip_sign(first, last);
+	const It it = detail::skip_digits(digits, last);
+	return (it == digits) ? first : it;
+}
+
+// grammar: [-+]?(?:[0-9]*\.?[0-9]+|[0-9]+\.)(?:[eE][-+]?[0-9]+)?
+template<typename It>
+It scan_real_literal(It first, It last)
+{
+	const It int_digits = detail::skip_sign(first, last);
+	It it = detail::skip_digits(int_digits, last);
+	bool has_digits = it != int_digits;
+	if (it != last && *it == '.') {
+		const It frac_digits = ++it;
+		it = detail::skip_digits(frac_digits, last);
+		has_digits = has_digits || it != frac_digits;
+	}
+	if (!has_digits)
+		return first;
+
+	// optional exponent, only consumed if complete
+	if (it != last && (*it == 'e' || *it == 'E')) {
+		It exp_sign = it;
+		const It exp_digits = detail::skip_sign(++exp_sign, last);
+		const It exp_end = detail::skip_digits(exp_digits, last);
+		if (exp_end != exp_digits)
+			it = exp_end;
+	}
+	return it;
+}
+
+// grammar: \(real,real\)|real
+template<typename It>
+It scan_complex_literal(It first, It last)
+{
+	if (first != last && *first == '(') {
+		It it = first;
+		++it;
+		It real_end = scan_real_literal(it, last);
+		if (real_end == it || real_end == last || *real_end != ',')
+			return first;
+		it = ++real_end;
+		It imag_end = scan_real_literal(it, last);
+		if (imag_end == it || imag_end == last || *imag_end != ')')
+			return first;
+		return ++imag_end;
+	}
+	return scan_real_literal(first, last);
+}
+
+// grammar: [^\(\)\{\}\,]+
+template<typename It>
+It scan_string_literal(It first, It last)
+{
+	It it = first;
+	while (it != last) {
+		switch (*it) {
+			case '(': case ')': case '{': case '}': case ',':
+				return it;
+			default:
+				++it;
+		}
+	}
+	return it;
+}
+
+/**
+ * Function objects wrapping the recognisers above, used to select them via a template argument.
+ * 'plain' recognisers never match structural characters ('{', '}', '(', ')', ','), so the end of
+ * their tokens can be taken from a structural_index.
+ */
+struct integer_literal_recogniser
+{
+	static const bool plain = true;
+	template<typename It>
+	It operator()(It first, It last) const { return scan_integer_literal(first, last); }
+};
+
+struct real_literal_recogniser
+{
+	static const bool plain = true;
+	template<typename It>
+	It operator()(It first, It last) const { return scan_real_literal(first, last); }
+};
+
+struct complex_literal_recogniser
+{
+	static const bool plain = false;
+	template<typename It>
+	It operator()(It first, It last) const { return scan_complex_literal(first, last); }
+};
+
+struct string_literal_recogniser
+{
+	static const bool plain = true;
+	template<typename It>
+	It operator()(It first, It last) const { return scan_string_literal(first, last); }
+};
+
+/**
+ * Returns a pointer to the first non-whitespace character in [first, last), or last.
+ */
+inline const char* skip_whitespace(const char* first, const char* last)
+{
+	while (first != last && is_space(*first))
+		++first;
+	return first;
+}
+
+/**
+ * Bidirectional iterator over a character range that steps over whitespace, i.e. it presents the
+ * input as if remove_whitespace() had been applied to it, without copying it.
+ * NOTE: Must be constructed at a non-whitespace position or at the end of the range.
+ */
+class skip_whitespace_iterator
+{
+public:
+	typedef std::bidirectional_iterator_tag iterator_category;
+	typedef char value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const char* pointer;
+	typedef const char& reference;
+
+	skip_whitespace_iterator() = default;
+	skip_whitespace_iterator(const char* it, const char* first, const char* last) : it_(it), first_(first), last_(last) { }
+
+	reference operator*() const { return *it_; }
+	pointer operator->() const { return it_; }
+
+	skip_whitespace_iterator& operator++()
+	{
+		it_ = skip_whitespace(it_ + 1, last_);
+		return *this;
+	}
+
+	skip_whitespace_iterator operator++(int)
+	{
+		skip_whitespace_iterator tmp = *this;
+		++(*this);
+		return tmp;
+	}
+
+	skip_whitespace_iterator& operator--()
+	{
+		do {
+			--it_;
+		} while (it_ != first_ && is_space(*it_));
+		return *this;
+	}
+
+	skip_whitespace_iterator operator--(int)
+	{
+		skip_whitespace_iterator tmp = *this;
+		--(*this);
+		return tmp;
+	}
+
+	bool operator==(const skip_whitespace_iterator& other) const { return it_ == other.it_; }
+	bool operator!=(const skip_whitespace_iterator& other) const { return it_ != other.it_; }
+
+	/**
+	 * Position in the underlying character range.
+	 */
+	const char* base() const { return it_; }
+
+private:
+	const char* it_ = nullptr;
+	const char* first_ = nullptr;
+	const char* last_ = nullptr;
+};
+
+/**
+ * Single pass, left to right scanner over a character range, driven by the parsers generated
+ * from type_to_parser (see parser.hpp). Whitespace is skipped while scanning, the input is
+ * never copied.
+ * With a structural_index, the end of plain tokens is looked up instead of being searched, and
+ * only validated.
+ */
+class scanner
+{
+public:
+	typedef skip_whitespace_iterator iterator;
+
+	scanner(const char* first, const char* last, structural_index* index = nullptr)
+		: it_(skip_whitespace(first, last)), last_(last), index_(index) { }
+
+	bool at_end() const { return it_ == last_; }
+
+	/**
+	 * Current position, i.e. where parsing stopped on malformed input.
+	 */
+	const char* position() const { return it_; }
+
+	/**
+	 * Consume 'c' if it is the next non-whitespace character.
+	 */
+	bool consume(char c)
+	{
+		if (it_ == last_ || *it_ != c)
+			return false;
+		it_ = skip_whitespace(it_ + 1, last_);
+		return true;
+	}
+
+	/**
+	 * Match a token at the current position using one of the *_recogniser function objects above
+	 * and advance behind it.
+	 * Returns false if there is no match, otherwise [first, last) is the matched token.
+	 * NOTE: The token may contain whitespace, e.g. "1 2" for "12", see parse_token().
+	 */
+	template<typename Recogniser>
+	bool token(Recogniser recognise, const char*& first, const char*& last)
+	{
+		if (Recogniser::plain && index_ && it_ != last_) {
+			// fast path: the token ends before the next structural character and has no inner whitespace
+			const char* gap_end = index_->next(it_);
+			const char* trimmed_end = gap_end;
+			while (trimmed_end != it_ && is_space(*(trimmed_end - 1)))
+				--trimmed_end;
+			if (trimmed_end != it_ && recognise(it_, trimmed_end) == trimmed_end) {
+				first = it_;
+				last = trimmed_end;
+				it_ = gap_end;
+				return true;
+			}
+		}
+
+		const iterator token_end = recognise(iterator(it_, it_, last_), iterator(last_, it_, last_));
+		if (token_end.base() == it_)
+			return false;
+		first = it_;
+		last = token_end.base();
+		while (is_space(*(last - 1))) // trailing whitespace stepped over by the iterator
+			--last;
+		it_ = token_end.base();
+		return true;
+	}
+
+private:
+	const char* it_;
+	const char* last_;
+	structural_index* index_;
+};
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_scanner_hpp
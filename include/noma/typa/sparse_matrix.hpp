@@ -0,0 +1,492 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_sparse_matrix_hpp
+#define noma_typa_sparse_matrix_hpp
+
+#include <algorithm>
+#include <cassert>
+#include <complex>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "debug.hpp"
+#include "noma/typa/matrix.hpp"
+#include "noma/typa/matrix_market.hpp"
+#include "noma/typa/parallel.hpp"
+#include "noma/typa/typa.hpp"
+#include "noma/typa/vector.hpp"
+
+namespace noma {
+namespace typa {
+
+namespace detail {
+
+// value of the entry mirrored at the diagonal of a symmetric .mtx file
+template<typename T>
+T mirrored_mtx_value(const T& value, mtx_symmetry symmetry)
+{
+	return (symmetry == mtx_symmetry::skew_symmetric) ? T(-value) : value;
+}
+
+template<typename T>
+std::complex<T> mirrored_mtx_value(const std::complex<T>& value, mtx_symmetry symmetry)
+{
+	return (symmetry == mtx_symmetry::skew_symmetric) ? -value : (symmetry == mtx_symmetry::hermitian) ? std::conj(value) : value;
+}
+
+} // namespace detail
+
+/**
+ * Sparse matrix in compressed sparse row (CSR) format: the nonzeros of row i are
+ * values()[row_offsets()[i] .. row_offsets()[i + 1]), in the columns col_indices()[...], sorted
+ * ascending. Memory is proportional to the number of nonzeros (plus one offset per row).
+ * Input is a literal of the extents and a coordinate list, "{(rows, cols), {(i, j, v), ...}}"
+ * (0-based), a Matrix Market (.mtx) file, or any dense matrix input (see matrix), converted.
+ */
+template<typename T>
+class sparse_matrix {
+public:
+	typedef T value_type;
+
+	sparse_matrix() = default;
+
+	/**
+	 * Empty 'rows' x 'cols' matrix, i.e. all zero.
+	 */
+	sparse_matrix(size_t rows, size_t cols) : rows_(rows), cols_(cols), row_offsets_(rows + 1, 0) { }
+
+	/**
+	 * Conversion from a dense matrix, storing the elements that are not T().
+	 */
+	template<size_t Alignment, typename Allocator>
+	explicit sparse_matrix(const matrix<T, Alignment, Allocator>& m) : rows_(m.rows()), cols_(m.cols()), row_offsets_(m.rows() + 1, 0)
+	{
+		for (size_t i = 0; i < rows_; ++i) {
+			for (size_t j = 0; j < cols_; ++j) {
+				if (m.at(i, j) != T()) {
+					col_indices_.push_back(j);
+					values_.push_back(m.at(i, j));
+				}
+			}
+			row_offsets_[i + 1] = values_.size();
+		}
+	}
+
+	size_t rows() const { return rows_; }
+	size_t cols() const { return cols_; }
+	size_t nonzeros() const { return values_.size(); }
+
+	const std::vector<size_t>& row_offsets() const { return row_offsets_; }
+	const std::vector<size_t>& col_indices() const { return col_indices_; }
+	const std::vector<T>& values() const { return values_; }
+
+	/**
+	 * Element (i, j), T() if it is not stored. Binary search within row i.
+	 */
+	T at(size_t i, size_t j) const
+	{
+		assert(i < rows_ && j < cols_);
+		const auto first = col_indices_.begin() + row_offsets_[i];
+		const auto last = col_indices_.begin() + row_offsets_[i + 1];
+		const auto it = std::lower_bound(first, last, j);
+		return (it != last && *it == j) ? values_[it - col_indices_.begin()] : T();
+	}
+
+	/**
+	 * Replace the contents by a 'rows' x 'cols' matrix with the coordinate 'entries' in any order,
+	 * values of duplicate coordinates are summed.
+	 * Sorted in linear time by rows (counting sort), rows with unsorted columns are sorted on their own.
+	 * Throws std::out_of_range if an index is outside of the extents, the contents are unchanged then.
+	 */
+	void assign(size_t rows, size_t cols, const std::vector<sparse_entry<T>>& entries)
+	{
+		NOMA_TYPA_STATS_PHASE(fill, entries.size() * sizeof(sparse_entry<T>));
+		for (size_t k = 0; k < entries.size(); ++k)
+			if (entries[k].row >= rows || entries[k].col >= cols)
+				throw std::out_of_range("noma::typa::sparse_matrix<T>::assign(): error: entry " + std::to_string(k) + " (" + std::to_string(entries[k].row) + ", " + std::to_string(entries[k].col) + ") is outside of the " + std::to_string(rows) + " x " + std::to_string(cols) + " matrix.");
+		rows_ = rows;
+		cols_ = cols;
+		row_offsets_.assign(rows + 1, 0);
+		for (const sparse_entry<T>& entry : entries)
+			++row_offsets_[entry.row + 1];
+		std::partial_sum(row_offsets_.begin(), row_offsets_.end(), row_offsets_.begin());
+
+		col_indices_.resize(entries.size());
+		values_.resize(entries.size());
+		std::vector<size_t> next(row_offsets_.begin(), row_offsets_.end() - 1);
+		for (const sparse_entry<T>& entry : entries) {
+			const size_t k = next[entry.row]++;
+			col_indices_[k] = entry.col;
+			values_[k] = entry.value;
+		}
+
+		// sort every row by column and sum duplicates, compacting in place
+		std::vector<std::pair<size_t, T>> row;
+		size_t nonzeros = 0;
+		for (size_t i = 0; i < rows; ++i) {
+			const size_t first = row_offsets_[i];
+			const size_t last = row_offsets_[i + 1];
+			if (!std::is_sorted(col_indices_.begin() + first, col_indices_.begin() + last)) {
+				row.clear();
+				for (size_t k = first; k < last; ++k)
+					row.emplace_back(col_indices_[k], values_[k]);
+				std::stable_sort(row.begin(), row.end(), [](const std::pair<size_t, T>& a, const std::pair<size_t, T>& b) { return a.first < b.first; });
+				for (size_t k = first; k < last; ++k) {
+					col_indices_[k] = row[k - first].first;
+					values_[k] = row[k - first].second;
+				}
+			}
+			row_offsets_[i] = nonzeros;
+			for (size_t k = first; k < last; ++k) {
+				if (nonzeros > row_offsets_[i] && col_indices_[nonzeros - 1] == col_indices_[k]) {
+					values_[nonzeros - 1] += values_[k];
+				} else {
+					col_indices_[nonzeros] = col_indices_[k];
+					values_[nonzeros] = values_[k];
+					++nonzeros;
+				}
+			}
+		}
+		row_offsets_[rows] = nonzeros;
+		col_indices_.resize(nonzeros);
+		values_.resize(nonzeros);
+	}
+
+	/**
+	 * Returns the dense equivalent.
+	 */
+	template<size_t Alignment = default_alignment, typename Allocator = aligned_allocator<T, Alignment>>
+	matrix<T, Alignment, Allocator> to_dense() const
+	{
+		matrix<T, Alignment, Allocator> result(rows_, cols_);
+		for (size_t i = 0; i < rows_; ++i)
+			for (size_t k = row_offsets_[i]; k < row_offsets_[i + 1]; ++k)
+				result.at(i, col_indices_[k]) = values_[k];
+		return result;
+	}
+
+	/**
+	 * Sparse matrix-vector product y = A * x, 'y' is resized to rows().
+	 * Large matrices are split into row ranges with similar numbers of nonzeros, computed by
+	 * thread_count() threads.
+	 */
+	template<size_t AlignmentX, typename AllocatorX, size_t AlignmentY, typename AllocatorY>
+	void multiply(const vector<T, AlignmentX, AllocatorX>& x, vector<T, AlignmentY, AllocatorY>& y) const
+	{
+		assert(x.size() == cols_);
+		y.resize(rows_);
+		const T* x_data = x.data();
+		T* y_data = y.data();
+		const size_t parts = (nonzeros() * sizeof(T) >= parallel_min_input_size) ? std::min(thread_count(), std::max<size_t>(rows_, 1)) : 1;
+
+		// part p covers the rows starting at its share of the nonzeros
+		auto part_first_row = [&](size_t p) -> size_t {
+			if (p == parts)
+				return rows_;
+			return std::lower_bound(row_offsets_.begin(), row_offsets_.end() - 1, p * nonzeros() / parts) - row_offsets_.begin();
+		};
+		auto multiply_rows = [&](size_t p) {
+			const size_t last = part_first_row(p + 1);
+			for (size_t i = part_first_row(p); i < last; ++i) {
+				T sum = T();
+				for (size_t k = row_offsets_[i]; k < row_offsets_[i + 1]; ++k)
+					sum += values_[k] * x_data[col_indices_[k]];
+				y_data[i] = sum;
+			}
+		};
+		if (parts == 1)
+			multiply_rows(0);
+		else
+			parallel_for(parts, multiply_rows);
+	}
+
+	template<size_t Alignment, typename Allocator>
+	vector<T, Alignment, Allocator> multiply(const vector<T, Alignment, Allocator>& x) const
+	{
+		vector<T, Alignment, Allocator> y(x.get_allocator());
+		multiply(x, y);
+		return y;
+	}
+
+	/**
+	 * Read a Matrix Market (.mtx) file in coordinate format, see matrix_market_file. The entries of
+	 * symmetric, skew-symmetric and hermitian files are mirrored at the diagonal.
+	 */
+	void load_mtx(const std::string& filename)
+	{
+		matrix_market_file file(filename);
+		std::vector<sparse_entry<T>> entries(file.entries());
+		file.read_entries(entries.data());
+		if (file.symmetry() != mtx_symmetry::general) {
+			for (size_t k = 0, n = entries.size(); k < n; ++k) {
+				const sparse_entry<T> entry = entries[k];
+				if (entry.row != entry.col)
+					entries.push_back({ entry.col, entry.row, detail::mirrored_mtx_value(entry.value, file.symmetry()) });
+			}
+		}
+		assign(file.rows(), file.cols(), entries);
+	}
+
+	/**
+	 * Write the nonzeros as coordinate list "{(i,j,v),...}" in row order, in chunks like matrix.
+	 */
+	void print(std::ostream& out) const
+	{
+		out << "{(" << rows_ << ',' << cols_ << "),{";
+		write_formatted(out, nonzeros(), sizeof(T), [&](format_buffer& buffer, size_t first, size_t last) {
+			size_t row = std::upper_bound(row_offsets_.begin(), row_offsets_.end(), first) - row_offsets_.begin() - 1;
+			for (size_t k = first; k < last; ++k) {
+				while (row_offsets_[row + 1] <= k)
+					++row;
+				buffer.append('(');
+				buffer.append_integer(static_cast<uint64_t>(row));
+				buffer.append(',');
+				buffer.append_integer(static_cast<uint64_t>(col_indices_[k]));
+				buffer.append(',');
+				buffer.append_value(values_[k]);
+				buffer.append(')');
+				if (k + 1 < nonzeros())
+					buffer.append(',');
+			}
+		});
+		out.write("}}", 2);
+	}
+
+	void scale(T factor)
+	{
+		for (T& value : values_)
+			value *= factor;
+	}
+
+private:
+	size_t rows_ = 0;
+	size_t cols_ = 0;
+	std::vector<size_t> row_offsets_ { 0 };
+	std::vector<size_t> col_indices_;
+	std::vector<T> values_;
+};
+
+/**
+ * Coordinate entry "(i,j,v)" of the list literal of sparse_matrix.
+ */
+template<typename T>
+struct type_to_regexp<sparse_entry<T>>
+{
+	static const std::string& exp_str();
+};
+
+template<typename T>
+const std::string& type_to_regexp<sparse_entry<T>>::exp_str()
+{
+	static const std::string& value { R"(\((?:)" + integer_literal() + R"(),(?:)" + integer_literal() + R"(),(?:)" + type_to_regexp<T>::exp_str() + R"()\))" };
+	return value;
+};
+
+namespace detail {
+
+/**
+ * Index or extent of a sparse_matrix literal, signed, so that negative values are rejected instead
+ * of wrapping around.
+ */
+template<typename Scanner>
+bool parse_index(Scanner& s, size_t& index)
+{
+	int64_t value;
+	if (!type_to_parser<int64_t>::parse(s, value) || value < 0)
+		return false;
+	index = static_cast<size_t>(value);
+	return true;
+}
+
+} // namespace detail
+
+template<typename T>
+struct type_to_parser<sparse_entry<T>>
+{
+	template<typename Scanner>
+	static bool parse(Scanner& s, sparse_entry<T>& entry)
+	{
+		return s.consume('(')
+		    && detail::parse_index(s, entry.row)
+		    && s.consume(',')
+		    && detail::parse_index(s, entry.col)
+		    && s.consume(',')
+		    && type_to_parser<T>::parse(s, entry.value)
+		    && s.consume(')');
+	}
+};
+
+template<typename T>
+struct type_to_regexp<sparse_matrix<T>>
+{
+	static const std::string& exp_str();
+};
+
+template<typename T>
+const std::string& type_to_regexp<sparse_matrix<T>>::exp_str()
+{
+	static const std::string& value { R"(\{)" + make_pair(integer_literal(), integer_literal()) + R"(,(?:)" + make_braced_list(type_to_regexp<sparse_entry<T>>::exp_str()) + R"(|\{\})\})" };
+	return value;
+};
+
+namespace detail {
+
+/**
+ * Extents "(rows, cols)" of a sparse_matrix literal, followed by the ',' before the entries.
+ */
+template<typename Scanner>
+bool parse_sparse_extents(Scanner& s, size_t& rows, size_t& cols)
+{
+	return s.consume('(') && parse_index(s, rows) && s.consume(',') && parse_index(s, cols) && s.consume(')') && s.consume(',');
+}
+
+/**
+ * Coordinate entries of a sparse_matrix literal, unlike other braced lists also "{}" for no nonzeros.
+ */
+template<typename T, typename Scanner>
+bool parse_sparse_entries(Scanner& s, std::vector<sparse_entry<T>>& entries)
+{
+	entries.clear();
+	if (!s.consume('{'))
+		return false;
+	if (s.consume('}'))
+		return true;
+	do {
+		entries.emplace_back();
+		if (!type_to_parser<sparse_entry<T>>::parse(s, entries.back()))
+			return false;
+	} while (s.consume(','));
+	return s.consume('}');
+}
+
+/**
+ * Build 'm' from coordinate entries parsed from a literal, entries outside of the extents are a
+ * parser_error.
+ */
+template<typename T>
+void assign_sparse_entries(sparse_matrix<T>& m, size_t rows, size_t cols, const std::vector<sparse_entry<T>>& entries)
+{
+	try {
+		m.assign(rows, cols, entries);
+	} catch (const std::out_of_range& e) {
+		throw parser_error(e.what());
+	}
+}
+
+} // namespace detail
+
+/**
+ * Parses the extents and the coordinate entries, then builds the CSR storage, see
+ * sparse_matrix::assign().
+ */
+template<typename T>
+struct type_to_parser<sparse_matrix<T>>
+{
+	template<typename Scanner>
+	static bool parse(Scanner& s, sparse_matrix<T>& m)
+	{
+		size_t rows;
+		size_t cols;
+		std::vector<sparse_entry<T>> entries;
+		if (!s.consume('{') || !detail::parse_sparse_extents(s, rows, cols) || !detail::parse_sparse_entries(s, entries) || !s.consume('}'))
+			return false;
+		detail::assign_sparse_entries(m, rows, cols, entries);
+		return true;
+	}
+};
+
+template<typename T>
+struct string_to_value<sparse_matrix<T>>
+{
+	static sparse_matrix<T> parse(const std::string& input)
+	{
+		return parse(input.data(), input.data() + input.size());
+	}
+
+	static sparse_matrix<T> parse(const char* first, const char* last)
+	{
+		NOMA_TYPA_STATS_CALL("noma::typa::string_to_value<sparse_matrix<T>>::parse()");
+		size_t rows;
+		size_t cols;
+		std::vector<sparse_entry<T>> entries;
+
+		// the list of entries between the extents and the closing '}' is parsed in parallel for large inputs
+		scanner s(first, last);
+		const char* list_last = last;
+		while (list_last != first && is_space(*(list_last - 1)))
+			--list_last;
+		bool valid = s.consume('{') && detail::parse_sparse_extents(s, rows, cols);
+		const char* error_position = s.position();
+		if (valid && (list_last == s.position() || *(list_last - 1) != '}')) {
+			valid = false;
+			error_position = list_last;
+		} else if (valid) {
+			scanner list(s.position(), list_last - 1);
+			if (!(list.consume('{') && list.consume('}') && list.at_end())) // "{}" has no nonzeros
+				valid = try_parse_braced_list(s.position(), list_last - 1, entries, error_position);
+		}
+		if (!valid)
+			throw parser_error("noma::typa::sparse_matrix<T>::operator>>(): error: malformed input at offset " + std::to_string(error_position - first) + ", should be the extents and a braced list of coordinate entries, e.g. {(rows, cols), {(i, j, T), ..}}.");
+		sparse_matrix<T> result;
+		detail::assign_sparse_entries(result, rows, cols, entries);
+		return result;
+	}
+};
+
+// output function
+template<typename T>
+std::ostream& operator<<(std::ostream& out, const sparse_matrix<T>& m)
+{
+	m.print(out);
+
+	return out;
+}
+
+// parser/input function
+template<typename T>
+std::istream& operator>>(std::istream& in, sparse_matrix<T>& m)
+{
+	NOMA_TYPA_STATS_CALL("noma::typa::sparse_matrix<T>::operator>>()");
+	bool is_list = in.peek() == '{'; // TODO: maybe do a smarter test here
+	DEBUG_ONLY( std::cout << "Parsing sparse matrix using protocol: " << (is_list ? "list" : "file") << std::endl; )
+	if (is_list)
+	{
+		if (!parse_stream<type_to_parser<sparse_matrix<T>>>(in, m))
+			throw parser_error("noma::typa::sparse_matrix<T>::operator>>(): error: malformed input, should be the extents and a braced list of coordinate entries, e.g. {(rows, cols), {(i, j, T), ..}}.");
+	}
+	else // handle as file name
+	{
+		std::string filename;
+		std::getline(in, filename);
+		DEBUG_ONLY( std::cout << "Parsing sparse matrix from file: " << filename << std::endl; )
+		if (is_mtx_filename(filename)) {
+			m.load_mtx(filename);
+			return in;
+		}
+		// dense file formats of matrix
+		matrix<T> dense;
+		if (is_npy_filename(filename)) {
+			dense.load_npy(filename);
+		} else {
+			text_file file(filename);
+			const std::vector<size_t> extents = file.read_extents(2); // rows, cols
+			dense.resize(extents[0], extents[1]);
+			file.read_values(dense.data(), dense.rows() * dense.cols(), dense.cols(), dense.stride());
+		}
+		m = sparse_matrix<T>(dense);
+	}
+
+	return in;
+}
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_sparse_matrix_hpp
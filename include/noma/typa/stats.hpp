@@ -0,0 +1,185 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_stats_hpp
+#define noma_typa_stats_hpp
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+
+namespace noma {
+namespace typa {
+
+/**
+ * Opt-in instrumentation of the parsers: calls, time and bytes per phase, and heap allocations.
+ * Recording is compiled in only if NOMA_TYPA_STATS is defined (CMake option NOMA_TYPA_STATS),
+ * otherwise the NOMA_TYPA_STATS_* macros below expand to nothing and all statistics stay zero.
+ * NOTE: With recording enabled, every timed phase costs two clock reads, e.g. per converted number.
+ */
+
+/**
+ * Phases the time spent in the library is attributed to:
+ *     grammar    - compiling regular expressions (compiled_regexp)
+ *     validation - regexp_match() and indexing structural characters (structural_index)
+ *     extraction - walking the structure of lists and pairs
+ *     conversion - converting literals to values (parse_token(), text_file)
+ *     file_io    - opening/mapping files, reading streams, writing .npy files
+ *     fill       - growing and filling vector and matrix storage
+ * Times are exclusive: time spent in a nested phase, e.g. conversion during extraction, only counts
+ * for the nested one. Phases on parallel threads are summed over all threads.
+ */
+enum class parse_phase { grammar, validation, extraction, conversion, file_io, fill };
+
+const size_t parse_phase_count = 6;
+
+const char* parse_phase_name(parse_phase phase);
+
+struct phase_stats
+{
+	uint64_t calls = 0;
+	uint64_t nanoseconds = 0;
+	uint64_t bytes = 0;
+};
+
+/**
+ * Statistics of the instrumented library functions, see get_parse_stats().
+ * 'allocations' counts the storage of vector and matrix (allocate_aligned()) and the growth of
+ * std::vector results of the list parsers.
+ */
+struct parse_stats
+{
+	phase_stats phases[parse_phase_count];
+	uint64_t api_calls = 0; // outermost calls of parse_braced_list(), parse_pair(), string_to_value, operator>>
+	uint64_t allocations = 0;
+	uint64_t allocated_bytes = 0;
+
+	const phase_stats& operator[](parse_phase phase) const { return phases[static_cast<size_t>(phase)]; }
+
+	parse_stats& operator-=(const parse_stats& other);
+
+	/**
+	 * Write a table with one line per phase.
+	 */
+	void print(std::ostream& out) const;
+};
+
+/**
+ * Totals of all threads since program start or the last reset_parse_stats().
+ */
+parse_stats get_parse_stats();
+
+void reset_parse_stats();
+
+/**
+ * Called at the end of every outermost call of an instrumented function, with its name, e.g.
+ * "noma::typa::parse_braced_list()", and the statistics recorded during the call, which include
+ * concurrent calls of other threads. Also called when the function throws.
+ * An empty function removes the callback.
+ * The callback is invoked without holding a lock, i.e. concurrently by several threads, and may call
+ * library functions, including set_parse_stats_callback(). Calls of instrumented functions from the
+ * callback are not reported to it.
+ * NOTE: The callback must not throw.
+ */
+typedef std::function<void(const char* name, const parse_stats& call_stats)> parse_stats_callback;
+
+void set_parse_stats_callback(parse_stats_callback callback);
+
+namespace detail {
+
+void record_phase(parse_phase phase, uint64_t nanoseconds, uint64_t bytes);
+void record_allocation(uint64_t bytes);
+
+class phase_timer;
+
+/**
+ * Innermost running phase_timer of the calling thread.
+ */
+phase_timer*& current_phase_timer();
+
+/**
+ * Times a phase from construction to destruction, minus the time of phase_timers nested in it.
+ */
+class phase_timer
+{
+public:
+	phase_timer(parse_phase phase, uint64_t bytes)
+		: phase_(phase), bytes_(bytes), parent_(current_phase_timer()), start_(std::chrono::steady_clock::now())
+	{
+		current_phase_timer() = this;
+	}
+
+	~phase_timer()
+	{
+		const uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+		if (parent_)
+			parent_->nested_ += elapsed;
+		current_phase_timer() = parent_;
+		record_phase(phase_, elapsed - std::min(nested_, elapsed), bytes_);
+	}
+
+	phase_timer(const phase_timer&) = delete;
+	phase_timer& operator=(const phase_timer&) = delete;
+
+	void add_bytes(uint64_t bytes) { bytes_ += bytes; }
+
+private:
+	parse_phase phase_;
+	uint64_t bytes_;
+	phase_timer* parent_;
+	uint64_t nested_ = 0;
+	std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Marks a call of an instrumented library function, the outermost one per thread counts as an api
+ * call and invokes the callback.
+ */
+class stats_call
+{
+public:
+	explicit stats_call(const char* name);
+	~stats_call();
+
+	stats_call(const stats_call&) = delete;
+	stats_call& operator=(const stats_call&) = delete;
+
+private:
+	const char* name_;
+	bool outermost_;
+	bool has_callback_ = false;
+	parse_stats start_;
+};
+
+} // namespace detail
+
+/**
+ * Usage:
+ *     NOMA_TYPA_STATS_PHASE(phase, bytes);     // time the rest of the scope as 'phase', e.g. conversion
+ *     NOMA_TYPA_STATS_PHASE_BYTES(bytes);      // add bytes to the above, when known later
+ *     NOMA_TYPA_STATS_CALL(name);              // mark the rest of the scope as call of 'name'
+ *     NOMA_TYPA_STATS_ALLOCATION(bytes);       // count a heap allocation
+ *     NOMA_TYPA_STATS_ONLY( statement )        // like DEBUG_ONLY()
+ */
+#ifdef NOMA_TYPA_STATS
+	#define NOMA_TYPA_STATS_PHASE(phase, bytes) ::noma::typa::detail::phase_timer noma_typa_phase_timer(::noma::typa::parse_phase::phase, (bytes))
+	#define NOMA_TYPA_STATS_PHASE_BYTES(bytes) noma_typa_phase_timer.add_bytes(bytes)
+	#define NOMA_TYPA_STATS_CALL(name) ::noma::typa::detail::stats_call noma_typa_stats_call(name)
+	#define NOMA_TYPA_STATS_ALLOCATION(bytes) ::noma::typa::detail::record_allocation(bytes)
+	#define NOMA_TYPA_STATS_ONLY(expr) expr
+#else
+	#define NOMA_TYPA_STATS_PHASE(phase, bytes)
+	#define NOMA_TYPA_STATS_PHASE_BYTES(bytes)
+	#define NOMA_TYPA_STATS_CALL(name)
+	#define NOMA_TYPA_STATS_ALLOCATION(bytes)
+	#define NOMA_TYPA_STATS_ONLY(expr)
+#endif
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_stats_hpp
@@ -0,0 +1,212 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_std_map_hpp
+#define noma_typa_std_map_hpp
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "noma/typa/braced_list.hpp"
+#include "noma/typa/format.hpp"
+#include "noma/typa/pair.hpp"
+#include "noma/typa/parser_error.hpp"
+#include "noma/typa/parser.hpp"
+
+namespace noma {
+namespace typa {
+
+// make std::map and std::unordered_map streamable, as braced lists of pairs: "{(K, V), (K, V), ...}"
+
+/**
+ * Type trait for the supported map types, std::map and std::unordered_map.
+ */
+template<typename T>
+struct is_std_map : std::false_type
+{
+};
+
+template<typename K, typename V, typename Compare, typename Allocator>
+struct is_std_map<std::map<K, V, Compare, Allocator>> : std::true_type
+{
+};
+
+template<typename K, typename V, typename Hash, typename Equal, typename Allocator>
+struct is_std_map<std::unordered_map<K, V, Hash, Equal, Allocator>> : std::true_type
+{
+};
+
+namespace detail {
+
+/**
+ * Make room for 'count' entries, i.e. size the buckets of a hash table once, nothing for a std::map.
+ */
+template<typename K, typename V, typename Hash, typename Equal, typename Allocator>
+void reserve_entries(std::unordered_map<K, V, Hash, Equal, Allocator>& map, size_t count)
+{
+	map.reserve(count);
+}
+
+template<typename Map>
+void reserve_entries(Map&, size_t)
+{
+}
+
+} // namespace detail
+
+/**
+ * Braced list of pairs parsed by KeyParser and ValueParser into a std::map or std::unordered_map,
+ * cf. braced_list_parser and pair_parser.
+ * Input Format: "{(K,V),(K,V),...}"
+ * Entries are inserted as they are parsed, with the end as hint, so sorted input builds a std::map
+ * in linear time. The buckets of a std::unordered_map are kept, see parse_map() for presizing.
+ * Throws parser_error on a duplicate key, which is detected by the insertion itself.
+ */
+template<typename KeyParser, typename ValueParser>
+struct map_parser
+{
+	template<typename Scanner, typename Map>
+	static bool parse(Scanner& s, Map& map)
+	{
+		map.clear();
+		if (!s.consume('{'))
+			return false;
+		do {
+			std::pair<typename Map::key_type, typename Map::mapped_type> entry;
+			if (!pair_parser<KeyParser, ValueParser>::parse(s, entry))
+				return false;
+			const size_t size = map.size();
+			const auto it = map.emplace_hint(map.end(), std::move(entry));
+			if (map.size() == size) {
+				// 'entry' is moved from, 'it' is the entry with the same key
+				format_buffer key;
+				key.append_value(it->first);
+				throw parser_error("noma::typa::map_parser::parse(): error: duplicate key '" + key.str() + "' in entry " + std::to_string(size) + ".");
+			}
+		} while (s.consume(','));
+		return s.consume('}');
+	}
+};
+
+template<typename Map>
+struct type_to_regexp<Map, typename std::enable_if<is_std_map<Map>::value>::type>
+{
+	static const std::string& exp_str()
+	{
+		static const std::string value { make_braced_list(make_pair(type_to_regexp<typename Map::key_type>::exp_str(), type_to_regexp<typename Map::mapped_type>::exp_str())) };
+		return value;
+	}
+};
+
+template<typename Map>
+struct type_to_parser<Map, typename std::enable_if<is_std_map<Map>::value>::type>
+	: map_parser<type_to_parser<typename Map::key_type>, type_to_parser<typename Map::mapped_type>>
+{
+};
+
+/**
+ * Parse a braced list of pairs into a std::map or std::unordered_map.
+ * Input Format: "{(K, V), (K, V), ...}"
+ * The entries are counted over the structural characters of [first, last) first, so a
+ * std::unordered_map is sized once instead of rehashing while it grows.
+ * Throws parser_error on malformed input and on duplicate keys.
+ */
+template<typename Map>
+Map parse_map(const char* first, const char* last)
+{
+	NOMA_TYPA_STATS_CALL("noma::typa::parse_map()");
+	Map result;
+	detail::reserve_entries(result, count_list_entries(first, last));
+	const char* error_position;
+
+	// validate and extract in one pass
+	if (!parse_whole<type_to_parser<Map>>(first, last, result, error_position))
+		throw parser_error("noma::typa::parse_map(): error: malformed input at offset " + std::to_string(error_position - first) + ", should be comma separated braced list of pairs, e.g. {(K, V), (K, V), ..}.");
+
+	return result;
+}
+
+template<typename Map>
+Map parse_map(const std::string& input)
+{
+	return parse_map<Map>(input.data(), input.data() + input.size());
+}
+
+/**
+ * Parse a map from the current line of 'in', see parse_braced_list(std::istream&). The entries
+ * are not counted in advance.
+ */
+template<typename Map>
+Map parse_map(std::istream& in)
+{
+	NOMA_TYPA_STATS_CALL("noma::typa::parse_map()");
+	Map result;
+
+	if (!parse_stream<type_to_parser<Map>>(in, result))
+		throw parser_error("noma::typa::parse_map(): error: malformed input, should be comma separated braced list of pairs, e.g. {(K, V), (K, V), ..}.");
+
+	return result;
+}
+
+template<typename Map>
+struct string_to_value<Map, typename std::enable_if<is_std_map<Map>::value>::type>
+{
+	static Map parse(const std::string& input)
+	{
+		return parse_map<Map>(input);
+	}
+
+	static Map parse(const char* first, const char* last)
+	{
+		return parse_map<Map>(first, last);
+	}
+};
+
+// Output Format: "{(K, V), (K, V), ...}", in iteration order
+template<typename Map>
+struct value_formatter<Map, typename std::enable_if<is_std_map<Map>::value>::type>
+{
+	static void format(format_buffer& out, const Map& map)
+	{
+		out.append('{');
+		bool first = true;
+		for (const auto& entry : map) {
+			if (!first)
+				out.append(", ", 2);
+			first = false;
+			out.append('(');
+			out.append_value(entry.first);
+			out.append(", ", 2);
+			out.append_value(entry.second);
+			out.append(')');
+		}
+		out.append('}');
+	}
+};
+
+template<typename Map>
+typename std::enable_if<is_std_map<Map>::value, std::ostream&>::type operator<<(std::ostream& out, const Map& map)
+{
+	format_buffer buffer(out);
+	buffer.append_value(map);
+	buffer.write_to(out);
+	return out;
+}
+
+template<typename Map>
+typename std::enable_if<is_std_map<Map>::value, std::istream&>::type operator>>(std::istream& in, Map& map)
+{
+	map = noma::typa::parse_map<Map>(in);
+
+	return in;
+}
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_std_map_hpp
@@ -12,6 +12,7 @@
 
 #include <boost/lexical_cast.hpp>
 
+#include "noma/typa/format.hpp"
 #include "noma/typa/parser_error.hpp"
 
 namespace noma {
@@ -36,6 +37,19 @@ const std::string& type_to_regexp<std::vector<T>>::exp_str()
 	return value;
 };
 
+template<typename T>
+struct type_to_parser<std::vector<T>> : braced_list_parser<type_to_parser<T>>
+{
+};
+
+/**
+ * Nested lists are parsed by a single nested_list_parser for all levels.
+ */
+template<typename T>
+struct type_to_parser<std::vector<std::vector<T>>> : nested_list_parser<type_to_parser<typename list_nesting<T>::leaf>>
+{
+};
+
 /**
  * This recursive specialisation allows arbitrary nesting of std::vector.
  */
@@ -46,20 +60,37 @@ struct string_to_value<std::vector<T>>
 	{
 		return parse_braced_list<T>(input);
 	}
+
+	static std::vector<T> parse(const char* first, const char* last)
+	{
+		return parse_braced_list<T>(first, last);
+	}
+};
+
+// Output Format: "{T, T, ...}"
+template<typename T>
+struct value_formatter<std::vector<T>>
+{
+	static void format(format_buffer& out, const std::vector<T>& vec)
+	{
+		const auto vec_size = vec.size();
+		out.append('{');
+		for (size_t i = 0; i < vec_size; ++i) {
+			out.append_value<T>(vec[i]);
+			if (i < (vec_size - 1))
+				out.append(", ", 2);
+		}
+		out.append('}');
+	}
 };
 
 template<typename T>
 std::ostream& operator<<(std::ostream& out, const std::vector<T>& vec)
 {
 	//std::cout << "printing std::vector" << std::endl;
-	const auto vec_size = vec.size();
-	out << '{';
-	for (size_t i = 0; i < vec_size; ++i) {
-		out << vec[i];
-		if (i < (vec_size - 1))
-			out << ", ";
-	}
-	out << '}';
+	format_buffer buffer(out);
+	buffer.append_value(vec);
+	buffer.write_to(out);
 	return out;
 }
 
@@ -67,10 +98,7 @@ template<typename T>
 std::istream& operator>>(std::istream& in, std::vector<T>& vec)
 {
 	//std::cout << "parsing std::vector" << std::endl;
-	std::string value;
-	std::getline(in, value);
-
-	vec = noma::typa::parse_braced_list<T>(value);
+	vec = noma::typa::parse_braced_list<T>(in);
 
 	return in;
 }
@@ -0,0 +1,186 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_stream_scanner_hpp
+#define noma_typa_stream_scanner_hpp
+
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "noma/typa/scanner.hpp"
+#include "noma/typa/structural_index.hpp"
+#include "noma/typa/util.hpp"
+
+namespace noma {
+namespace typa {
+
+/**
+ * Scanner with the interface of scanner (see scanner.hpp) reading one line of a std::istream in
+ * fixed size chunks, so that the parsers from type_to_parser can consume a literal while it is read.
+ * Only the current chunk and a partially read token are kept in memory: the buffer grows beyond
+ * chunk_size only for single tokens longer than that. Buffers that did not grow are reused by the
+ * next stream_scanner of the same thread, i.e. parsing many short lines does not allocate.
+ * Like std::getline(), input ends at the next '\n', which is extracted, or at the end of the stream.
+ * Every chunk is indexed with a structural_index for the fast path of scanner::token().
+ */
+class stream_scanner
+{
+public:
+	typedef skip_whitespace_iterator iterator;
+
+	static const size_t chunk_size = 64 * 1024;
+
+	stream_scanner(std::istream& in) : in_(in), buffer_(std::move(spare_buffer()))
+	{
+		buffer_.resize(2 * chunk_size + 1);
+		it_ = end_ = buffer_.data();
+		skip_whitespace();
+	}
+
+	~stream_scanner()
+	{
+		if (buffer_.size() == 2 * chunk_size + 1)
+			spare_buffer() = std::move(buffer_);
+	}
+
+	stream_scanner(const stream_scanner&) = delete;
+	stream_scanner& operator=(const stream_scanner&) = delete;
+
+	bool at_end()
+	{
+		skip_whitespace();
+		return it_ == end_;
+	}
+
+	/**
+	 * Consume 'c' if it is the next non-whitespace character.
+	 */
+	bool consume(char c)
+	{
+		if (it_ == end_ || *it_ != c)
+			return false;
+		++it_;
+		skip_whitespace();
+		return true;
+	}
+
+	/**
+	 * Match a token at the current position, see scanner::token().
+	 * NOTE: [first, last) is only valid until the next call.
+	 */
+	template<typename Recogniser>
+	bool token(Recogniser recognise, const char*& first, const char*& last)
+	{
+		while (true) {
+			// recognisers look ahead at most a token, ensure a chunk is available unless the input ends before
+			if (!exhausted_ && static_cast<size_t>(end_ - it_) < chunk_size) {
+				fill();
+				continue;
+			}
+
+			if (Recogniser::plain && it_ != end_) {
+				// fast path as in scanner::token(), unless the token might continue in the next chunk
+				const char* gap_end = index_.next(it_);
+				const char* trimmed_end = gap_end;
+				while (trimmed_end != it_ && is_space(*(trimmed_end - 1)))
+					--trimmed_end;
+				if ((gap_end != end_ || exhausted_) && trimmed_end != it_ && recognise(it_, trimmed_end) == trimmed_end) {
+					first = it_;
+					last = trimmed_end;
+					it_ = gap_end;
+					return true;
+				}
+			}
+
+			const iterator token_end = recognise(iterator(it_, it_, end_), iterator(end_, it_, end_));
+			if (token_end.base() == end_ && !exhausted_) {
+				fill(); // the token might continue in the next chunk
+				continue;
+			}
+			if (token_end.base() == it_)
+				return false;
+			first = it_;
+			last = token_end.base();
+			while (is_space(*(last - 1))) // trailing whitespace stepped over by the iterator
+				--last;
+			it_ = token_end.base();
+			return true;
+		}
+	}
+
+	/**
+	 * Discard the rest of the input, i.e. the current line, e.g. after an error.
+	 */
+	void skip_rest()
+	{
+		it_ = end_;
+		if (!exhausted_) {
+			in_.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+			exhausted_ = true;
+		}
+	}
+
+private:
+	// empty while taken by a stream_scanner, a nested one allocates its own buffer
+	static std::vector<char>& spare_buffer()
+	{
+		static thread_local std::vector<char> buffer;
+		return buffer;
+	}
+
+	void skip_whitespace()
+	{
+		while (true) {
+			while (it_ != end_ && is_space(*it_))
+				++it_;
+			if (it_ != end_ || exhausted_)
+				return;
+			fill();
+		}
+	}
+
+	/**
+	 * Move the unconsumed characters to the front of the buffer and append the next chunk.
+	 */
+	void fill()
+	{
+		const size_t kept = end_ - it_;
+		std::memmove(buffer_.data(), it_, kept);
+		if (buffer_.size() - kept < chunk_size + 1)
+			buffer_.resize(2 * buffer_.size()); // token longer than a chunk
+		char* read_pos = buffer_.data() + kept;
+
+		// get() stops before '\n' and stores a terminating '\0', hence the + 1
+		NOMA_TYPA_STATS_PHASE(file_io, 0);
+		in_.get(read_pos, static_cast<std::streamsize>(chunk_size + 1), '\n');
+		const size_t count = static_cast<size_t>(in_.gcount());
+		NOMA_TYPA_STATS_PHASE_BYTES(count);
+		if (count == 0) {
+			// nothing extracted: at the end of the line or stream, like std::getline() this is no failure
+			in_.clear(in_.rdstate() & ~std::ios_base::failbit);
+			if (!in_.eof())
+				in_.ignore(); // '\n'
+			exhausted_ = true;
+		}
+		it_ = buffer_.data();
+		end_ = read_pos + count;
+		index_.reset(it_, end_);
+	}
+
+	std::istream& in_;
+	std::vector<char> buffer_;
+	const char* it_;
+	const char* end_;
+	structural_index index_ { nullptr, nullptr };
+	bool exhausted_ = false;
+};
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_stream_scanner_hpp
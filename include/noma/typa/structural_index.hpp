@@ -0,0 +1,111 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_structural_index_hpp
+#define noma_typa_structural_index_hpp
+
+#include <cstddef>
+#include <vector>
+
+namespace noma {
+namespace typa {
+
+/**
+ * Append pointers to all structural characters, i.e. '{', '}', '(', ')' and ',', in [first, last)
+ * to 'positions'.
+ * Vectorised, the implementation (AVX2, SSE4.2 or scalar) is selected at run time.
+ */
+void find_structurals(const char* first, const char* last, std::vector<const char*>& positions);
+
+/**
+ * Copy [first, last) to 'out' leaving out all whitespace (see is_space()) and return the end of the
+ * output. 'out' may be equal to 'first' for in place operation, otherwise it must have room for
+ * last - first characters.
+ * Vectorised like find_structurals().
+ */
+char* copy_without_whitespace(const char* first, const char* last, char* out);
+
+/**
+ * Name of the implementation selected at run time ("avx2", "sse4.2" or "scalar").
+ */
+const char* structural_index_implementation();
+
+namespace detail {
+
+/**
+ * One implementation of find_structurals() and copy_without_whitespace().
+ */
+struct structural_kernels
+{
+	void (*find_structurals)(const char*, const char*, std::vector<const char*>&);
+	char* (*copy_without_whitespace)(const char*, const char*, char*);
+	const char* name;
+};
+
+/**
+ * All implementations supported by the CPU, the fastest first, which is the one selected, e.g. to test
+ * every one of them.
+ */
+const std::vector<structural_kernels>& structural_index_kernels();
+
+} // namespace detail
+
+/**
+ * Index of the structural characters of an input, built lazily window by window, so memory usage
+ * is bounded independently of the input size.
+ * Used by the scanner to find the end of tokens without looking at every character twice.
+ */
+class structural_index
+{
+public:
+	static const size_t window_size = 64 * 1024;
+
+	// inputs below this size are not worth indexing
+	static const size_t min_input_size = 16 * 1024;
+
+	structural_index(const char* first, const char* last) : indexed_end_(first), last_(last) { }
+
+	/**
+	 * Start over with the input [first, last), keeping the allocated memory.
+	 */
+	void reset(const char* first, const char* last)
+	{
+		indexed_end_ = first;
+		last_ = last;
+		positions_.clear();
+		cursor_ = 0;
+	}
+
+	/**
+	 * Returns a pointer to the first structural character at or after 'pos', or the end of the
+	 * input if there is none.
+	 * NOTE: 'pos' must not decrease between calls.
+	 */
+	const char* next(const char* pos)
+	{
+		while (true) {
+			while (cursor_ < positions_.size()) {
+				if (positions_[cursor_] >= pos)
+					return positions_[cursor_];
+				++cursor_;
+			}
+			if (indexed_end_ == last_)
+				return last_;
+			index_next_window();
+		}
+	}
+
+private:
+	void index_next_window();
+
+	const char* indexed_end_;
+	const char* last_;
+	std::vector<const char*> positions_;
+	size_t cursor_ = 0;
+};
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_structural_index_hpp
@@ -0,0 +1,642 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_tensor_hpp
+#define noma_typa_tensor_hpp
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring> // memcpy()
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "debug.hpp"
+#include "noma/typa/aligned_memory.hpp"
+#include "noma/typa/parallel.hpp"
+#include "noma/typa/typa.hpp"
+
+namespace noma {
+namespace typa {
+
+/**
+ * N-dimensional array in a single contiguous allocation, row major, i.e. the last index is the
+ * fastest. The storage is aligned to Alignment bytes and obtained from Allocator, like matrix.
+ * Elements are accessed with operator()(i, j, ...), unchecked in release builds, or at(i, j, ...),
+ * which throws std::out_of_range.
+ * Storage is reused by resize() and assignment as long as it is large enough.
+ */
+template<typename T, size_t N, size_t Alignment = default_alignment, typename Allocator = aligned_allocator<T, Alignment>>
+class tensor {
+	static_assert(N > 0, "noma::typa::tensor<T, N, Alignment, Allocator>: N must be at least 1.");
+	static_assert(is_valid_alignment(Alignment) && Alignment >= alignof(T), "noma::typa::tensor<T, N, Alignment, Allocator>: Alignment must be a power of two and at least alignof(T).");
+
+	typedef std::allocator_traits<Allocator> allocator_traits;
+
+public:
+	typedef T value_type;
+	typedef Allocator allocator_type;
+	typedef std::array<size_t, N> extents_type;
+
+	static const size_t rank = N;
+	static const size_t alignment = Alignment;
+
+	tensor() = default;
+
+	explicit tensor(const Allocator& alloc) : alloc_(alloc) { }
+
+	explicit tensor(const extents_type& extents, T value = T(), const Allocator& alloc = Allocator()) : alloc_(alloc)
+	{
+		resize(extents);
+		std::fill(data_, data_ + size_, value);
+	}
+
+	// copy
+	tensor(const tensor& other)
+		: alloc_(allocator_traits::select_on_container_copy_construction(other.alloc_))
+	{
+		resize(other.extents_);
+		copy_elements(other.data_, size_, data_);
+	}
+
+	// assignment, reuses the storage if it is large enough
+	tensor& operator=(const tensor& other)
+	{
+		if (this == &other)
+			return *this;
+		assign_allocator(other.alloc_, typename allocator_traits::propagate_on_container_copy_assignment());
+		resize(other.extents_);
+		copy_elements(other.data_, size_, data_);
+
+		return *this;
+	}
+
+	// move
+	tensor(tensor&& other) noexcept
+		: data_(other.data_), capacity_(other.capacity_), size_(other.size_), extents_(other.extents_), strides_(other.strides_), alloc_(std::move(other.alloc_))
+	{
+		other.release(); // move ownership
+	}
+
+	// move assignment, takes over the storage unless the allocators differ and do not propagate
+	tensor& operator=(tensor&& other) noexcept(allocator_traits::propagate_on_container_move_assignment::value)
+	{
+		if (this == &other)
+			return *this;
+		move_assign(other, typename allocator_traits::propagate_on_container_move_assignment());
+
+		return *this;
+	}
+
+	~tensor()
+	{
+		deallocate();
+	}
+
+	allocator_type get_allocator() const { return alloc_; }
+
+	T const * data() const { return data_; }
+	T* data() { return data_; }
+
+	/**
+	 * Number of elements, i.e. the product of the extents.
+	 */
+	size_t size() const { return size_; }
+
+	const extents_type& extents() const { return extents_; }
+	size_t extent(size_t dimension) const { return extents_[dimension]; }
+
+	/**
+	 * Distance between consecutive indices of every dimension in elements, 1 for the last one.
+	 */
+	const extents_type& strides() const { return strides_; }
+
+	template<typename... Indices>
+	T const & operator()(Indices... indices) const
+	{
+		return data_[offset(indices...)];
+	}
+
+	template<typename... Indices>
+	T& operator()(Indices... indices)
+	{
+		return data_[offset(indices...)];
+	}
+
+	template<typename... Indices>
+	T const & at(Indices... indices) const
+	{
+		return data_[checked_offset(indices...)];
+	}
+
+	template<typename... Indices>
+	T& at(Indices... indices)
+	{
+		return data_[checked_offset(indices...)];
+	}
+
+	/**
+	 * Resize to 'extents', the contents are not preserved. The storage is only reallocated if it is
+	 * too small.
+	 * Throws std::length_error if the number of elements does not fit into size_t.
+	 */
+	void resize(const extents_type& extents)
+	{
+		const bool empty = std::find(extents.begin(), extents.end(), size_t(0)) != extents.end();
+		extents_type strides;
+		size_t size = 1;
+		for (size_t d = N; d-- > 0; ) {
+			strides[d] = size;
+			if (!empty && size > std::numeric_limits<size_t>::max() / extents[d])
+				throw std::length_error("noma::typa::tensor<T, N>::resize(): error: the number of elements does not fit into size_t.");
+			size *= extents[d];
+		}
+		if (size > capacity_) {
+			deallocate();
+			data_ = allocate_elements(alloc_, size);
+			capacity_ = size;
+			assert(reinterpret_cast<uintptr_t>(data_) % Alignment == 0);
+		}
+		extents_ = extents;
+		strides_ = strides;
+		size_ = size;
+	}
+
+	/**
+	 * Make room for 'capacity' elements, preserving the contents, i.e. the tensor can grow up to
+	 * 'capacity' elements via resize() without losing them.
+	 */
+	void reserve(size_t capacity)
+	{
+		if (capacity <= capacity_)
+			return;
+		NOMA_TYPA_STATS_PHASE(fill, size_ * sizeof(T));
+		T* data = allocate_elements(alloc_, capacity);
+		std::move(data_, data_ + size_, data);
+		deallocate_elements(alloc_, data_, capacity_);
+		data_ = data;
+		capacity_ = capacity;
+		assert(reinterpret_cast<uintptr_t>(data_) % Alignment == 0);
+	}
+
+	/**
+	 * Number of elements the storage can hold without reallocation.
+	 */
+	size_t capacity() const { return capacity_; }
+
+	/**
+	 * Write the tensor as N-deep braced list, e.g. "{{{1,2},{3,4}},{{5,6},{7,8}}}", in chunks as it is
+	 * formatted, see write_formatted().
+	 */
+	void print(std::ostream& out) const
+	{
+		if (size_ == 0) { // no elements to write the braces of the lists with
+			std::string lists;
+			append_empty_lists(lists, 0);
+			out << lists;
+			return;
+		}
+		out.put('{');
+		write_formatted(out, size_, sizeof(T), [&](format_buffer& buffer, size_t first, size_t last) {
+			for (size_t k = first; k < last; ++k) {
+				// lists of the inner dimensions that start or end at element k
+				for (size_t d = 1; d < N && k % strides_[N - 1 - d] == 0; ++d)
+					buffer.append('{');
+				buffer.append_value(data_[k]);
+				for (size_t d = 1; d < N && (k + 1) % strides_[N - 1 - d] == 0; ++d)
+					buffer.append('}');
+				if (k < size_ - 1)
+					buffer.append(',');
+			}
+		});
+		out.put('}');
+	}
+
+	/**
+	 * Write the elements in row major order, separated by 'delimiter', with a line break after every
+	 * row of the last dimension, cf. matrix::print_raw(). Preceded by the extents, this is the text
+	 * file protocol.
+	 */
+	void print_raw(std::ostream& out, const char& delimiter = '\t') const
+	{
+		const size_t row_length = extents_[N - 1];
+		write_formatted(out, size_, sizeof(T), [&](format_buffer& buffer, size_t first, size_t last) {
+			for (size_t k = first; k < last; ++k) {
+				buffer.append_value(data_[k]);
+				buffer.append(((k + 1) % row_length == 0) ? '\n' : delimiter);
+			}
+		});
+	}
+
+	/**
+	 * Write the tensor to 'filename' in NumPy's binary .npy format, see npy.hpp.
+	 */
+	void save_npy(const std::string& filename) const
+	{
+		write_npy(filename, npy_descr<T>::value(), std::vector<size_t>(extents_.begin(), extents_.end()), data_, size_ * sizeof(T));
+	}
+
+	/**
+	 * Read the tensor from a .npy file holding an N-dimensional array of T, in C or Fortran order.
+	 * The file is memory mapped, a C order payload is copied with a single memcpy().
+	 * Throws parser_error if T is not trivially copyable.
+	 */
+	void load_npy(const std::string& filename)
+	{
+		load_npy(filename, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+	}
+
+	void scale(T factor)
+	{
+		for (size_t k = 0; k < size_; ++k)
+			data_[k] *= factor;
+	}
+
+private:
+	/**
+	 * Lists of a tensor without elements, e.g. "{{},{}}" for the extents {2, 0}, like matrix::print().
+	 */
+	void append_empty_lists(std::string& lists, size_t d) const
+	{
+		lists += '{';
+		if (extents_[d] != 0) { // a later extent is 0
+			for (size_t i = 0; i < extents_[d]; ++i) {
+				if (i > 0)
+					lists += ',';
+				append_empty_lists(lists, d + 1);
+			}
+		}
+		lists += '}';
+	}
+
+	void load_npy(const std::string& filename, std::true_type)
+	{
+		const npy_file file(filename);
+		const char* payload = file.payload<T>(N);
+		extents_type extents;
+		std::copy(file.shape().begin(), file.shape().end(), extents.begin());
+		resize(extents);
+		NOMA_TYPA_STATS_PHASE(fill, size_ * sizeof(T));
+		if (!file.fortran_order()) {
+			std::memcpy(data_, payload, size_ * sizeof(T));
+			return;
+		}
+		// Fortran order: the first index is the fastest, walk the elements in our order
+		extents_type fortran_strides;
+		size_t stride = 1;
+		for (size_t d = 0; d < N; ++d) {
+			fortran_strides[d] = stride;
+			stride *= extents_[d];
+		}
+		extents_type index {};
+		size_t fortran_offset = 0;
+		for (size_t k = 0; k < size_; ++k) {
+			std::memcpy(data_ + k, payload + fortran_offset * sizeof(T), sizeof(T));
+			for (size_t d = N; d-- > 0; ) {
+				fortran_offset += fortran_strides[d];
+				if (++index[d] < extents_[d])
+					break;
+				fortran_offset -= index[d] * fortran_strides[d];
+				index[d] = 0;
+			}
+		}
+	}
+
+	void load_npy(const std::string&, std::false_type)
+	{
+		throw parser_error("noma::typa::tensor<T, N>::load_npy(): error: .npy files need a trivially copyable element type.");
+	}
+
+	template<typename... Indices>
+	size_t offset(Indices... indices) const
+	{
+		static_assert(sizeof...(Indices) == N, "noma::typa::tensor<T, N, Alignment, Allocator>: number of indices must be N.");
+		const size_t index[N] { static_cast<size_t>(indices)... };
+		size_t result = 0;
+		for (size_t d = 0; d < N; ++d) {
+			assert(index[d] < extents_[d]);
+			result += index[d] * strides_[d];
+		}
+		return result;
+	}
+
+	template<typename... Indices>
+	size_t checked_offset(Indices... indices) const
+	{
+		static_assert(sizeof...(Indices) == N, "noma::typa::tensor<T, N, Alignment, Allocator>: number of indices must be N.");
+		const size_t index[N] { static_cast<size_t>(indices)... };
+		for (size_t d = 0; d < N; ++d)
+			if (index[d] >= extents_[d])
+				throw std::out_of_range("noma::typa::tensor<T, N>::at(): error: index " + std::to_string(index[d]) + " of dimension " + std::to_string(d) + " is out of range, extent is " + std::to_string(extents_[d]) + ".");
+		return offset(indices...);
+	}
+
+	void deallocate()
+	{
+		deallocate_elements(alloc_, data_, capacity_);
+		release();
+	}
+
+	// forget the storage without releasing it, after moving it elsewhere
+	void release()
+	{
+		data_ = nullptr;
+		capacity_ = 0;
+		size_ = 0;
+		extents_ = extents_type();
+		strides_ = extents_type();
+	}
+
+	void assign_allocator(const Allocator& alloc, std::true_type)
+	{
+		if (alloc_ != alloc)
+			deallocate(); // the storage must be released by the allocator it came from
+		alloc_ = alloc;
+	}
+
+	void assign_allocator(const Allocator&, std::false_type) { }
+
+	void move_assign(tensor& other, std::true_type)
+	{
+		deallocate();
+		alloc_ = std::move(other.alloc_);
+		take_storage(other);
+	}
+
+	void move_assign(tensor& other, std::false_type)
+	{
+		if (alloc_ == other.alloc_) {
+			deallocate();
+			take_storage(other);
+			return;
+		}
+		// the storage of 'other' cannot be released by our allocator, move the elements instead
+		resize(other.extents_);
+		std::move(other.data_, other.data_ + size_, data_);
+	}
+
+	void take_storage(tensor& other)
+	{
+		data_ = other.data_;
+		capacity_ = other.capacity_;
+		size_ = other.size_;
+		extents_ = other.extents_;
+		strides_ = other.strides_;
+		other.release();
+	}
+
+	T* data_ = nullptr;
+	size_t capacity_ = 0;
+	size_t size_ = 0;
+	extents_type extents_ {};
+	extents_type strides_ {};
+	Allocator alloc_;
+};
+
+template<typename T, size_t N, size_t Alignment, typename Allocator>
+struct type_to_regexp<tensor<T, N, Alignment, Allocator>>
+{
+	static const std::string& exp_str();
+};
+
+template<typename T, size_t N, size_t Alignment, typename Allocator>
+const std::string& type_to_regexp<tensor<T, N, Alignment, Allocator>>::exp_str()
+{
+	static const std::string& value { [] {
+		std::string exp { type_to_regexp<T>::exp_str() };
+		for (size_t d = 0; d < N; ++d)
+			exp = make_braced_list(exp);
+		return exp;
+	}() };
+	return value;
+};
+
+/**
+ * Parses N-deep braced lists directly into the storage of the tensor, which grows geometrically,
+ * with an explicit stack of the open lists, cf. nested_list_parser. The first list of every level
+ * determines the extent of its dimension, all others are compared to it in the same pass.
+ */
+template<typename T, size_t N, size_t Alignment, typename Allocator>
+struct type_to_parser<tensor<T, N, Alignment, Allocator>>
+{
+	typedef tensor<T, N, Alignment, Allocator> tensor_type;
+	typedef typename tensor_type::extents_type extents_type;
+
+	template<typename Scanner>
+	static bool parse(Scanner& s, tensor_type& t)
+	{
+		extents_type extents {}; // 0 until the first list of a level is closed
+		extents_type flat {};
+		size_t size = 0;
+		bool rectangular = true;
+		t.resize(flat);
+		const bool valid = parse_lists(s, 0, extents, [&]() -> T& {
+			if (size == t.capacity()) {
+				flat[0] = size;
+				std::fill(flat.begin() + 1, flat.end(), 1);
+				t.resize(flat); // the elements to preserve
+				t.reserve(std::max(2 * size, min_capacity));
+			}
+			return t.data()[size++];
+		}, rectangular, extents[0]);
+		if (!valid)
+			return false;
+
+		check_rectangular(rectangular);
+		t.resize(extents);
+		DEBUG_ONLY( std::cout << "Parsed tensor size: " << t.size() << std::endl; )
+		return true;
+	}
+
+	/**
+	 * Parse the list of level 'top' and all lists nested in it, the elements are parsed into the T&
+	 * returned by 'next()', in order. 'top_count' is the number of entries of the top list, the
+	 * others are compared to 'extents', where 0 is replaced by the first count of the level, and
+	 * 'rectangular' is cleared if they differ.
+	 */
+	template<typename Scanner, typename Next>
+	static bool parse_lists(Scanner& s, size_t top, extents_type& extents, Next next, bool& rectangular, size_t& top_count)
+	{
+		size_t counts[N]; // entries of the open list per level
+		size_t level = top;
+		counts[top] = 0;
+		if (!s.consume('{'))
+			return false;
+		while (true) {
+			// every entry above the last dimension is a list
+			while (level + 1 < N) {
+				if (!s.consume('{'))
+					return false;
+				counts[++level] = 0;
+			}
+			if (!type_to_parser<T>::parse(s, next()))
+				return false;
+
+			// close finished lists, up to the one continued with a ','
+			while (true) {
+				++counts[level];
+				if (s.consume(','))
+					break;
+				if (!s.consume('}'))
+					return false;
+				if (level == top) {
+					top_count = counts[top];
+					return true;
+				}
+				if (extents[level] == 0)
+					extents[level] = counts[level];
+				else if (counts[level] != extents[level])
+					rectangular = false;
+				--level;
+			}
+		}
+	}
+
+	/**
+	 * Parse the entry 'i' of the outermost list, i.e. an element or an N-1 dimensional list, into its
+	 * place in 't', which has its final extents. Surplus elements are parsed, but dropped.
+	 */
+	template<typename Scanner>
+	static bool parse_slice(Scanner& s, tensor_type& t, size_t i, bool& rectangular)
+	{
+		if (N == 1)
+			return type_to_parser<T>::parse(s, t.data()[i]);
+
+		const size_t slice_size = t.strides()[0];
+		T* slice = t.data() + i * slice_size;
+		extents_type extents = t.extents();
+		size_t k = 0;
+		size_t count = 0;
+		T surplus;
+		const bool valid = parse_lists(s, 1, extents, [&]() -> T& {
+			++k;
+			return (k <= slice_size) ? slice[k - 1] : surplus;
+		}, rectangular, count);
+		rectangular = rectangular && count == t.extent(1) && k == slice_size;
+		return valid;
+	}
+
+	static void check_rectangular(bool rectangular)
+	{
+		if (!rectangular)
+			throw parser_error("noma::typa::tensor<T, N>::operator>>(): error: lists of the same level have differing lengths, the shape must be rectangular.");
+	}
+
+	static const size_t min_capacity = 16;
+};
+
+template<typename T, size_t N, size_t Alignment, typename Allocator>
+struct string_to_value<tensor<T, N, Alignment, Allocator>>
+{
+	typedef tensor<T, N, Alignment, Allocator> tensor_type;
+	typedef type_to_parser<tensor_type> parser;
+
+	static tensor_type parse(const std::string& input)
+	{
+		return parse(input.data(), input.data() + input.size());
+	}
+
+	static tensor_type parse(const char* first, const char* last)
+	{
+		NOMA_TYPA_STATS_CALL("noma::typa::string_to_value<tensor<T, N>>::parse()");
+		tensor_type result;
+		std::atomic<bool> rectangular { true };
+
+		// large inputs: entries of the outermost list are parsed in parallel, the first one determines
+		// the other extents
+		auto resize = [&](size_t count) {
+			typename parser::extents_type extents {};
+			extents[0] = count;
+			if (N > 1) {
+				scanner s(first, last);
+				T scratch;
+				bool first_rectangular = true;
+				if (!s.consume('{') || !parser::parse_lists(s, 1, extents, [&]() -> T& { return scratch; }, first_rectangular, extents[1]))
+					return false; // reported by the serial parser
+			}
+			result.resize(extents);
+			return true;
+		};
+		auto parse_slices = [&](scanner& s, size_t offset, size_t count) {
+			bool valid = true;
+			bool chunk_rectangular = true;
+			for (size_t i = 0; valid && i < count; ++i)
+				valid = (i == 0 || s.consume(',')) && parser::parse_slice(s, result, offset + i, chunk_rectangular);
+			if (!chunk_rectangular)
+				rectangular = false;
+			return valid;
+		};
+
+		bool valid = true;
+		const char* error_position = first;
+		if (!detail::parallel_parse_braced_list(first, last, std::integral_constant<bool, N == 1 && detail::is_plain_parser<type_to_parser<T>>::value>(), resize, parse_slices))
+			valid = parse_whole<parser>(first, last, result, error_position);
+		if (!valid)
+			throw parser_error("noma::typa::tensor<T, N>::operator>>(): error: malformed input at offset " + std::to_string(error_position - first) + ", should be " + std::to_string(N) + " levels of nested braced lists, e.g. {{ T, T, ..}, ..}.");
+		parser::check_rectangular(rectangular);
+		return result;
+	}
+};
+
+// output function
+template<typename T, size_t N, size_t Alignment, typename Allocator>
+std::ostream& operator<<(std::ostream& out, const tensor<T, N, Alignment, Allocator>& t)
+{
+	t.print(out);
+
+	return out;
+}
+
+// parser/input function
+template<typename T, size_t N, size_t Alignment, typename Allocator>
+std::istream& operator>>(std::istream& in, tensor<T, N, Alignment, Allocator>& t)
+{
+	NOMA_TYPA_STATS_CALL("noma::typa::tensor<T, N>::operator>>()");
+	bool is_list = in.peek() == '{'; // TODO: maybe do a smarter test here
+	DEBUG_ONLY( std::cout << "Parsing tensor using protocol: " << (is_list ? "list" : "file") << std::endl; )
+	if (is_list)
+	{
+		// parsed while reading, the list is never held in memory as a whole
+		if (!parse_stream<type_to_parser<tensor<T, N, Alignment, Allocator>>>(in, t))
+			throw parser_error("noma::typa::tensor<T, N>::operator>>(): error: malformed input, should be " + std::to_string(N) + " levels of nested braced lists, e.g. {{ T, T, ..}, ..}.");
+	}
+	else // handle as file name
+	{
+		std::string filename;
+		std::getline(in, filename);
+		DEBUG_ONLY( std::cout << "Parsing tensor from file: " << filename << std::endl; )
+		if (is_npy_filename(filename)) {
+			t.load_npy(filename);
+			return in;
+		}
+		text_file file(filename);
+		const std::vector<size_t> extents = file.read_extents(N);
+		typename tensor<T, N, Alignment, Allocator>::extents_type shape;
+		std::copy(extents.begin(), extents.end(), shape.begin());
+		t.resize(shape);
+		file.read_values(t.data(), t.size());
+	}
+
+	return in;
+}
+
+template<typename T, size_t N, size_t Alignment, typename Allocator>
+const size_t tensor<T, N, Alignment, Allocator>::rank;
+
+template<typename T, size_t N, size_t Alignment, typename Allocator>
+const size_t tensor<T, N, Alignment, Allocator>::alignment;
+
+template<typename T, size_t N, size_t Alignment, typename Allocator>
+const size_t type_to_parser<tensor<T, N, Alignment, Allocator>>::min_capacity;
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_tensor_hpp
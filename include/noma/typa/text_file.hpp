@@ -0,0 +1,182 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_text_file_hpp
+#define noma_typa_text_file_hpp
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "noma/typa/basic_types.hpp"
+#include "noma/typa/decompressor.hpp"
+#include "noma/typa/mapped_file.hpp"
+#include "noma/typa/parallel.hpp"
+#include "noma/typa/parser_error.hpp"
+#include "noma/typa/scanner.hpp"
+#include "noma/typa/util.hpp"
+
+namespace noma {
+namespace typa {
+
+namespace detail {
+
+typedef std::pair<const char*, const char*> text_range;
+
+/**
+ * Split [first, last) into up to 'n' parts of similar size, cut at whitespace so that no token is split.
+ */
+std::vector<text_range> split_at_whitespace(const char* first, const char* last, size_t n);
+
+/**
+ * Number of whitespace separated tokens in [first, last).
+ */
+size_t count_tokens(const char* first, const char* last);
+
+/**
+ * Returns "in '<filename>' at line <l>, column <c>" for 'position' in the file contents starting at
+ * 'first', which is at line 'first_line', column 'first_column' (1-based).
+ */
+std::string text_location(const std::string& filename, const char* first, const char* position, size_t first_line = 1, size_t first_column = 1);
+
+/**
+ * Returns a pointer to the end of the token starting at 'first'.
+ */
+inline const char* token_end(const char* first, const char* last)
+{
+	while (first != last && !is_space(*first))
+		++first;
+	return first;
+}
+
+} // namespace detail
+
+/**
+ * Loader for the text file protocol of vector and matrix: the extents, e.g. "rows cols", followed by
+ * the elements in row major order, all separated by whitespace.
+ * The file is memory mapped. Large files are converted by thread_count() threads, each working on a
+ * part of the elements, split at whitespace, and writing directly into the destination.
+ * Files compressed with gzip or zstd (see detect_compression()) are decompressed by a separate
+ * thread into a bounded number of windows (see decompressor), every window is converted like an
+ * uncompressed file while the next one is decompressed.
+ * Errors are reported with the line and column of the offending token.
+ * NOTE: Elements are converted with string_to_value<T> and must not contain whitespace.
+ */
+class text_file
+{
+public:
+	explicit text_file(const std::string& filename);
+
+	/**
+	 * Read 'dimensions' extents from the beginning of the file.
+	 */
+	std::vector<size_t> read_extents(size_t dimensions);
+
+	/**
+	 * Convert the elements behind the extents into 'values', which has room for 'count' elements.
+	 * Throws parser_error if an element is malformed or if there are not exactly 'count' elements.
+	 * With a 'stride', the elements are stored as rows of 'row_length' elements, whose beginnings are
+	 * 'stride' elements apart, e.g. into a matrix with padded rows.
+	 */
+	template<typename T>
+	void read_values(T* values, size_t count, size_t row_length = 0, size_t stride = 0)
+	{
+		if (stride == 0) // contiguous, i.e. a single row
+			row_length = stride = std::max<size_t>(count, 1);
+
+		// an uncompressed file is a single window
+		size_t offset = 0;
+		do {
+			offset = read_window(values, offset, count, row_length, stride);
+		} while (next_window());
+		if (offset != count)
+			throw parser_error("noma::typa::text_file::read_values(): error: '" + filename_ + "' contains " + std::to_string(offset) + " elements, expected " + std::to_string(count) + ".");
+	}
+
+private:
+	/**
+	 * Convert the elements of the current window, i.e. [position_, last_), which are preceded by
+	 * 'offset' elements, see read_values(). Returns the number of elements up to the end of the window.
+	 * Nothing is converted once there are more than 'count' elements.
+	 */
+	template<typename T>
+	size_t read_window(T* values, size_t offset, size_t count, size_t row_length, size_t stride)
+	{
+		const char* first = position_;
+		const char* last = last_;
+		const size_t parts = (static_cast<size_t>(last - first) >= parallel_min_input_size) ? thread_count() : 1;
+		const std::vector<detail::text_range> ranges = detail::split_at_whitespace(first, last, parts);
+
+		// count first, so that every part knows where its elements go
+		std::vector<size_t> offsets(ranges.size() + 1, 0);
+		offsets[0] = offset;
+		parallel_for(ranges.size(), [&](size_t i) {
+			NOMA_TYPA_STATS_PHASE(validation, ranges[i].second - ranges[i].first);
+			offsets[i + 1] = detail::count_tokens(ranges[i].first, ranges[i].second);
+		});
+		for (size_t i = 0; i < ranges.size(); ++i)
+			offsets[i + 1] += offsets[i];
+		if (offsets.back() > count)
+			return offsets.back(); // reported by read_values()
+
+		// convert, the first malformed token in file order is reported
+		std::vector<const char*> errors(ranges.size(), nullptr);
+		parallel_for(ranges.size(), [&](size_t i) {
+			NOMA_TYPA_STATS_PHASE(conversion, ranges[i].second - ranges[i].first);
+			size_t col = offsets[i] % row_length;
+			T* out = values + (offsets[i] / row_length) * stride + col;
+			const char* end = ranges[i].second;
+			for (const char* it = skip_whitespace(ranges[i].first, end); it != end; it = skip_whitespace(it, end)) {
+				const char* token_last = detail::token_end(it, end);
+				try {
+					*out++ = parse_value<T>(it, token_last);
+					if (++col == row_length) {
+						col = 0;
+						out += stride - row_length;
+					}
+				} catch (boost::bad_lexical_cast&) {
+					errors[i] = it;
+					return;
+				}
+				it = token_last;
+			}
+		});
+		for (const char* error : errors)
+			if (error)
+				throw parser_error("noma::typa::text_file::read_values(): error: malformed element '" + std::string(error, detail::token_end(error, last)) + "' " + location(error) + ".");
+		return offsets.back();
+	}
+
+	/**
+	 * Move on to the next window of a compressed file, returns false at the end of the file, and
+	 * always for uncompressed files.
+	 */
+	bool next_window();
+
+	/**
+	 * Location of 'position' in the current window, see detail::text_location().
+	 */
+	std::string location(const char* position) const;
+
+	std::string filename_;
+	mapped_file file_;
+	std::unique_ptr<decompressor> decompressor_; // only for compressed files
+
+	// current window, the whole file if uncompressed, and the line and column of its beginning
+	const char* first_;
+	const char* last_;
+	const char* position_;
+	size_t first_line_ = 1;
+	size_t first_column_ = 1;
+};
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_text_file_hpp
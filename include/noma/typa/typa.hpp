@@ -6,19 +6,28 @@
 #define noma_typa_typa_hpp
 
 #include "noma/typa/parser_error.hpp"
+#include "noma/typa/stats.hpp"
 #include "noma/typa/util.hpp"
+#include "noma/typa/parser.hpp"
 #include "noma/typa/basic_types.hpp"
+#include "noma/typa/format.hpp"
 
 #include "noma/typa/braced_list.hpp"
 #include "noma/typa/pair.hpp"
 
+#include "noma/typa/npy.hpp"
+#include "noma/typa/text_file.hpp"
 #include "noma/typa/wrapper.hpp"
 #include "noma/typa/vector_wrapper.hpp"
 #include "noma/typa/pair_wrapper.hpp"
 #include "noma/typa/std_vector.hpp"
+#include "noma/typa/std_map.hpp"
 
 #include "noma/typa/vector.hpp"
 #include "noma/typa/matrix.hpp"
+#include "noma/typa/sparse_matrix.hpp"
+#include "noma/typa/tensor.hpp"
+#include "noma/typa/view.hpp"
 
 namespace noma {
 namespace typa {
@@ -5,10 +5,14 @@
 #ifndef noma_typa_util_hpp
 #define noma_typa_util_hpp
 
+#include <regex>
 #include <string>
+#include <type_traits>
 
 #include <boost/lexical_cast.hpp>
 
+#include "noma/typa/stats.hpp"
+
 namespace noma {
 namespace typa {
 
@@ -22,24 +26,102 @@ struct type_to_regexp
 {
 };
 
+/**
+ * Process-wide cache of the compiled regular expression for a type T, built from
+ * type_to_regexp<T>::exp_str() on first use.
+ * NOTE: Initialisation of function local statics is thread-safe (C++11) and matching only uses the
+ *       const interface of std::regex, so the cached object can be shared between threads.
+ */
+template<typename T>
+struct compiled_regexp
+{
+	static const std::regex& get()
+	{
+		static const std::regex value { compile() };
+		return value;
+	}
+
+private:
+	static std::regex compile()
+	{
+		NOMA_TYPA_STATS_PHASE(grammar, type_to_regexp<T>::exp_str().size());
+		return std::regex(type_to_regexp<T>::exp_str());
+	}
+};
+
 /**
  * Conversion object to parse a type from a string value. Can be specialised if needed
  * Default string to value conversion uses boost::lexical_cast, which uses stream operators
  * if available.
+ * Arithmetic types use the faster, locale independent conversions from number.hpp instead, see
+ * basic_types.hpp.
  */
-template<typename T>
+template<typename T, typename Enable = void>
 struct string_to_value
 {
 	static T parse(const std::string& input)
 	{
 		return boost::lexical_cast<T>(input);
 	}
+
+	static T parse(const char* first, const char* last)
+	{
+		return boost::lexical_cast<T>(first, last - first);
+	}
+};
+
+namespace detail {
+
+/**
+ * Detects whether string_to_value<T> has a parse(const char*, const char*) overload.
+ */
+template<typename T>
+class has_range_parse
+{
+	template<typename U>
+	static auto test(int) -> decltype(U::parse(static_cast<const char*>(nullptr), static_cast<const char*>(nullptr)), std::true_type());
+	template<typename U>
+	static std::false_type test(...);
+public:
+	static const bool value = decltype(test<string_to_value<T>>(0))::value;
 };
 
+template<typename T>
+T parse_value(const char* first, const char* last, std::true_type)
+{
+	return string_to_value<T>::parse(first, last);
+}
+
+template<typename T>
+T parse_value(const char* first, const char* last, std::false_type)
+{
+	return string_to_value<T>::parse(std::string(first, last));
+}
+
+} // namespace detail
+
+/**
+ * Parse [first, last) with string_to_value<T>, without a copy if the specialisation provides a
+ * parse(const char* first, const char* last) overload.
+ */
+template<typename T>
+T parse_value(const char* first, const char* last)
+{
+	return detail::parse_value<T>(first, last, std::integral_constant<bool, detail::has_range_parse<T>::value>());
+}
+
+/**
+ * Whitespace as removed by remove_whitespace(), i.e. ::isspace() in the "C" locale.
+ */
+inline bool is_space(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
 /**
  * Remove all whitespaces from a string, by modifying it and returning the same reference.
- * This is called on every input before parsing to avoid bloating the regular expressions
- * with possible whitespace everywhere.
+ * The regular expressions contain no whitespace, so this must be called on inputs before matching.
+ * NOTE: The parsers step over whitespace while scanning instead (see scanner.hpp), with the same result.
  */
 std::string& remove_whitespace(std::string& str);
 
@@ -48,6 +130,16 @@ std::string& remove_whitespace(std::string& str);
  */
 std::string remove_whitespace(const std::string& const_str);
 
+/**
+ * Check if the whitespace free input matches type_to_regexp<T> using the cached expression.
+ */
+template<typename T>
+bool regexp_match(const std::string& input)
+{
+	NOMA_TYPA_STATS_PHASE(validation, input.size());
+	return std::regex_match(remove_whitespace(input), compiled_regexp<T>::get());
+}
+
 /**
  * Write comma separated list of map values to output stream.
  */
@@ -5,56 +5,93 @@
 #ifndef noma_typa_vector_hpp
 #define noma_typa_vector_hpp
 
+#include <algorithm>
+#include <cstdint>
 #include <cstring> // memcpy()
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <type_traits>
 
 #include "debug.hpp"
+#include "noma/typa/aligned_memory.hpp"
+#include "noma/typa/expression.hpp"
 #include "noma/typa/typa.hpp"
 
 namespace noma {
 namespace typa {
 
-template<typename T>
+/**
+ * Vector with storage aligned to Alignment bytes, obtained from Allocator, which must provide that
+ * alignment.
+ * Storage is reused by resize() and assignment as long as it is large enough.
+ */
+template<typename T, size_t Alignment = default_alignment, typename Allocator = aligned_allocator<T, Alignment>>
 class vector {
+	static_assert(is_valid_alignment(Alignment) && Alignment >= alignof(T), "noma::typa::vector<T, Alignment, Allocator>: Alignment must be a power of two and at least alignof(T).");
+
+	typedef std::allocator_traits<Allocator> allocator_traits;
+
 public:
+	typedef T value_type;
+	typedef Allocator allocator_type;
+
+	static const size_t alignment = Alignment;
+
 	vector() = default;
 
-	vector(size_t size, T value = T()) : size_(size)
+	explicit vector(const Allocator& alloc) : alloc_(alloc) { }
+
+	vector(size_t size, T value = T(), const Allocator& alloc = Allocator()) : alloc_(alloc)
 	{
-		allocate();
+		resize(size);
 		init(value);
 	}
 
 	// copy
 	vector(const vector& other)
-		: size_(other.size_)
+		: alloc_(allocator_traits::select_on_container_copy_construction(other.alloc_))
 	{
-		allocate();
-		for (size_t i = 0; i < size_; ++i) {
-			at(i) = other.at(i);
-		}
+		resize(other.size_);
+		copy_elements(other.data_, size_, data_);
 	}
 
-	// assignment
+	// assignment, reuses the storage if it is large enough
 	vector& operator=(const vector& other)
 	{
-		deallocate();
-		size_ = other.size_;
-		allocate();
-		for (size_t i = 0; i < size_; ++i) {
-			at(i) = other.at(i);
-		}
+		if (this == &other)
+			return *this;
+		assign_allocator(other.alloc_, typename allocator_traits::propagate_on_container_copy_assignment());
+		resize(other.size_);
+		copy_elements(other.data_, size_, data_);
 
 		return *this;
 	}
 
 	// move
-	vector(vector&& other)
-		: size_(other.size_)
+	vector(vector&& other) noexcept
+		: data_(other.data_), capacity_(other.capacity_), size_(other.size_), alloc_(std::move(other.alloc_))
+	{
+		other.release(); // move ownership
+	}
+
+	// move assignment, takes over the storage unless the allocators differ and do not propagate
+	vector& operator=(vector&& other) noexcept(allocator_traits::propagate_on_container_move_assignment::value)
+	{
+		if (this == &other)
+			return *this;
+		move_assign(other, typename allocator_traits::propagate_on_container_move_assignment());
+
+		return *this;
+	}
+
+	/**
+	 * Evaluate an elementwise vector expression, see expression.hpp.
+	 */
+	template<typename E>
+	vector(const expression<E>& e, const Allocator& alloc = Allocator()) : alloc_(alloc)
 	{
-		data_ = other.data_; // move ownership
-		other.data_ = nullptr; // invalidate
+		*this = e;
 	}
 
 	~vector()
@@ -62,6 +99,31 @@ public:
 		deallocate();
 	}
 
+	/**
+	 * Evaluate an elementwise vector expression in a single loop, e.g. y = a * x + b * z, see
+	 * expression.hpp. The vector is resized to the size of 'e'.
+	 */
+	template<typename E>
+	vector& operator=(const expression<E>& e)
+	{
+		static_assert(E::dimensions == 1, "noma::typa::vector<T, Alignment, Allocator>::operator=(): not a vector expression.");
+		resize(e.derived().cols());
+		evaluate_expression(e.derived(), data_, 1, size_, size_);
+		return *this;
+	}
+
+	// elementwise with a vector, a vector expression or a scalar
+	template<typename X>
+	vector& operator+=(const X& x) { return *this = *this + x; }
+	template<typename X>
+	vector& operator-=(const X& x) { return *this = *this - x; }
+	template<typename X>
+	vector& operator*=(const X& x) { return *this = *this * x; }
+	template<typename X>
+	vector& operator/=(const X& x) { return *this = *this / x; }
+
+	allocator_type get_allocator() const { return alloc_; }
+
 	T const * data() const { return data_; }
 	T* data() { return data_; }
 	size_t size() const { return size_; }
@@ -81,28 +143,79 @@ public:
 		return data_[i];
 	}
 
+	/**
+	 * Resize to 'size' elements. The storage is only reallocated if it is too small, the contents are
+	 * not preserved then.
+	 */
 	void resize(size_t size)
 	{
+		if (size > capacity_) {
+			deallocate();
+			data_ = allocate_elements(alloc_, size);
+			capacity_ = size;
+			assert(reinterpret_cast<uintptr_t>(data_) % Alignment == 0);
+		}
 		size_ = size;
+	}
+
+	/**
+	 * Make room for 'capacity' elements, preserving the contents, i.e. the vector can grow up to
+	 * 'capacity' elements via resize() without losing them.
+	 */
+	void reserve(size_t capacity)
+	{
+		if (capacity <= capacity_)
+			return;
+		NOMA_TYPA_STATS_PHASE(fill, size_ * sizeof(T));
+		T* data = allocate_elements(alloc_, capacity);
+		std::move(data_, data_ + size_, data);
+		const size_t size = size_;
 		deallocate();
-		allocate();
+		data_ = data;
+		capacity_ = capacity;
+		size_ = size;
+		assert(reinterpret_cast<uintptr_t>(data_) % Alignment == 0);
 	}
 
+	/**
+	 * Number of elements the storage can hold without reallocation.
+	 */
+	size_t capacity() const { return capacity_; }
+
+	/**
+	 * Write "{T,T,...}" to 'out'. Reals are written in their shortest round trip representation,
+	 * unless 'out' is set to std::scientific or std::fixed (see format_buffer). Output is written in
+	 * chunks as it is formatted, see write_formatted().
+	 */
 	void print(std::ostream& out) const
 	{
-		std::ostringstream oss;
-		oss.precision(std::numeric_limits<double>::max_digits10);
-		oss << std::scientific;
+		out.put('{');
+		write_formatted(out, size_, sizeof(T), [&](format_buffer& buffer, size_t first, size_t last) {
+			for (size_t i = first; i < last; ++i) {
+				buffer.append_value(data_[i]);
+				if (i < size_ - 1)
+					buffer.append(',');
+			}
+		});
+		out.put('}');
+	}
 
-		oss << "{";
-		for (size_t i = 0; i < size_; ++i) {
-			oss << at(i);
-			if (i < size_ - 1)
-				oss << ',';
-		}
-		oss << "}";
+	/**
+	 * Write the vector to 'filename' in NumPy's binary .npy format, see npy.hpp.
+	 */
+	void save_npy(const std::string& filename) const
+	{
+		write_npy(filename, npy_descr<T>::value(), { size_ }, data_, size_ * sizeof(T));
+	}
 
-		out << oss.str();
+	/**
+	 * Read the vector from a .npy file holding a 1-dimensional array of T.
+	 * The file is memory mapped, the payload is copied with a single memcpy().
+	 * Throws parser_error if T is not trivially copyable.
+	 */
+	void load_npy(const std::string& filename)
+	{
+		load_npy(filename, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
 	}
 
 	void scale(T factor)
@@ -118,102 +231,195 @@ public:
 	}
 
 private:
-	void allocate()
+	void load_npy(const std::string& filename, std::true_type)
+	{
+		const npy_file file(filename);
+		const char* payload = file.payload<T>(1);
+		resize(file.shape()[0]);
+		NOMA_TYPA_STATS_PHASE(fill, size_ * sizeof(T));
+		std::memcpy(data_, payload, size_ * sizeof(T));
+	}
+
+	void load_npy(const std::string&, std::false_type)
 	{
-		assert(data_ == nullptr);
-		data_ = new T[size_];
+		throw parser_error("noma::typa::vector<T>::load_npy(): error: .npy files need a trivially copyable element type.");
 	}
 
 	void deallocate()
 	{
-		if (data_) {
-			delete [] data_;
-			data_ = nullptr;
+		deallocate_elements(alloc_, data_, capacity_);
+		release();
+	}
+
+	// forget the storage without releasing it, after moving it elsewhere
+	void release()
+	{
+		data_ = nullptr;
+		capacity_ = 0;
+		size_ = 0;
+	}
+
+	void assign_allocator(const Allocator& alloc, std::true_type)
+	{
+		if (alloc_ != alloc)
+			deallocate(); // the storage must be released by the allocator it came from
+		alloc_ = alloc;
+	}
+
+	void assign_allocator(const Allocator&, std::false_type) { }
+
+	void move_assign(vector& other, std::true_type)
+	{
+		deallocate();
+		alloc_ = std::move(other.alloc_);
+		take_storage(other);
+	}
+
+	void move_assign(vector& other, std::false_type)
+	{
+		if (alloc_ == other.alloc_) {
+			deallocate();
+			take_storage(other);
+			return;
 		}
+		// the storage of 'other' cannot be released by our allocator, move the elements instead
+		resize(other.size_);
+		std::move(other.data_, other.data_ + size_, data_);
+	}
+
+	void take_storage(vector& other)
+	{
+		data_ = other.data_;
+		capacity_ = other.capacity_;
+		size_ = other.size_;
+		other.release();
 	}
 
 	void init(T value) {
-		for (size_t i = 0; i < size_; ++i) {
-			at(i) = value;
-		}
+		std::fill(data_, data_ + size_, value);
 	}
 
 	T* data_ = nullptr;
+	size_t capacity_ = 0;
 	size_t size_ = 0;
+	Allocator alloc_;
 };
 
-template<typename T>
-struct type_to_regexp<vector<T>>
+template<typename T, size_t Alignment, typename Allocator>
+struct type_to_regexp<vector<T, Alignment, Allocator>>
 {
 	static const std::string& exp_str();
 };
 
-template<typename T>
-const std::string& type_to_regexp<vector<T>>::exp_str()
+template<typename T, size_t Alignment, typename Allocator>
+const std::string& type_to_regexp<vector<T, Alignment, Allocator>>::exp_str()
 {
 	static const std::string& value { make_braced_list(type_to_regexp<T>::exp_str()) };
 	return value;
 };
 
 /**
- * This recursive specialisation allows arbitrary nesting of vector_wrapper.
+ * Parses the entries directly into the storage of the vector, which grows geometrically.
  */
-template<typename T>
-struct string_to_value<vector<T>>
+template<typename T, size_t Alignment, typename Allocator>
+struct type_to_parser<vector<T, Alignment, Allocator>>
 {
-	static vector<T> parse(const std::string& input)
+	template<typename Scanner>
+	static bool parse(Scanner& s, vector<T, Alignment, Allocator>& v)
 	{
-		DEBUG_ONLY( std::cout << "Parsing vector from list: " << input << std::endl; )
-		std::vector<T> vec = parse_braced_list<T>(input);
-		DEBUG_ONLY( std::cout << "Parsed vector size: " << vec.size() << std::endl; )
+		v.resize(0);
+		return braced_list_parser<type_to_parser<T>>::parse_into(s, [&]() -> T& {
+			const size_t size = v.size();
+			if (size == v.capacity())
+				v.reserve(std::max(2 * size, min_capacity));
+			v.resize(size + 1);
+			return v[size];
+		});
+	}
+
+	static const size_t min_capacity = 16;
+};
+
+template<typename T, size_t Alignment, typename Allocator>
+struct expression_operand<vector<T, Alignment, Allocator>>
+{
+	static const bool value = true;
+	typedef array_expression<T, 1> type;
+	static type make(const vector<T, Alignment, Allocator>& v) { return type(v.data(), 1, v.size(), v.size()); }
+};
 
-		vector<T> result(vec.size());
+/**
+ * This recursive specialisation allows arbitrary nesting of vector_wrapper.
+ */
+template<typename T, size_t Alignment, typename Allocator>
+struct string_to_value<vector<T, Alignment, Allocator>>
+{
+	static vector<T, Alignment, Allocator> parse(const std::string& input)
+	{
+		return parse(input.data(), input.data() + input.size());
+	}
 
-		for (size_t i = 0; i < vec.size(); ++i)
-			result.at(i) = vec[i];
+	static vector<T, Alignment, Allocator> parse(const char* first, const char* last)
+	{
+		NOMA_TYPA_STATS_CALL("noma::typa::string_to_value<vector<T>>::parse()");
+		DEBUG_ONLY( std::cout << "Parsing vector from list: " << std::string(first, last) << std::endl; )
+		vector<T, Alignment, Allocator> result;
+		// entries without structural characters: every comma separates two of them in valid input
+		if (detail::is_plain_parser<type_to_parser<T>>::value)
+			result.reserve(std::count(first, last, ',') + 1);
+		const char* error_position;
+		if (!try_parse_braced_list(first, last, result, error_position)) // parallel for large inputs
+			throw parser_error("noma::typa::string_to_value<vector<T>>::parse(): error: malformed input at offset " + std::to_string(error_position - first) + ", should be comma separated braced list, e.g. { T, T, ..}.");
+		DEBUG_ONLY( std::cout << "Parsed vector size: " << result.size() << std::endl; )
 
 		DEBUG_ONLY( std::cout << "Parsed vector from list: " << result << std::endl; )
 		return result;
 	}
 };
 
-template<typename T>
-std::ostream& operator<<(std::ostream& out, const vector<T>& v)
+template<typename T, size_t Alignment, typename Allocator>
+std::ostream& operator<<(std::ostream& out, const vector<T, Alignment, Allocator>& v)
 {
 	v.print(out);
 	return out;
 }
 
 // parser function
-template<typename T>
-std::istream& operator>>(std::istream& in, vector<T>& v)
+template<typename T, size_t Alignment, typename Allocator>
+std::istream& operator>>(std::istream& in, vector<T, Alignment, Allocator>& v)
 {
-	std::string line;
-	std::getline(in, line);
-	bool is_list = line.front() == '{'; // TODO: maybe do a smarter test here
+	NOMA_TYPA_STATS_CALL("noma::typa::vector<T>::operator>>()");
+	bool is_list = in.peek() == '{'; // TODO: maybe do a smarter test here
 	DEBUG_ONLY( std::cout << "Parsing vector using protocol: " << (is_list ? "list" : "file") << std::endl; )
 	if (is_list)
 	{
-		v = string_to_value<vector<T>>::parse(line);
+		// parsed while reading, the list is never held in memory as a whole
+		if (!parse_stream<type_to_parser<vector<T, Alignment, Allocator>>>(in, v))
+			throw parser_error("noma::typa::vector<T>::operator>>(): error: malformed input, should be comma separated braced list, e.g. { T, T, ..}.");
 	}
 	else // handle as file name
 	{
-		std::string& filename = line;
+		std::string filename;
+		std::getline(in, filename);
 		DEBUG_ONLY( std::cout << "Parsing vector from file: " << filename << std::endl; )
-		std::ifstream fs(filename);
-		if (fs.fail())
-			throw parser_error("noma::typa::vector<T>::operator>>(): error: could not open file '" + filename + "'.");
-		size_t size;
-		fs >> size;
-		v.resize(size);
-		for (size_t i = 0; i < size; ++i) {
-			fs >> v.at(i);
+		if (is_npy_filename(filename)) {
+			v.load_npy(filename);
+			return in;
 		}
+		text_file file(filename);
+		v.resize(file.read_extents(1)[0]);
+		file.read_values(v.data(), v.size());
 	}
 
 	return in;
 }
 
+template<typename T, size_t Alignment, typename Allocator>
+const size_t vector<T, Alignment, Allocator>::alignment;
+
+template<typename T, size_t Alignment, typename Allocator>
+const size_t type_to_parser<vector<T, Alignment, Allocator>>::min_capacity;
+
 } // namespace typa
 } // namespace noma
 
@@ -31,6 +31,16 @@ const std::string& type_to_regexp<vector_wrapper<T>>::exp_str()
 	return value;
 };
 
+template<typename T>
+struct type_to_parser<vector_wrapper<T>>
+{
+	template<typename Scanner>
+	static bool parse(Scanner& s, vector_wrapper<T>& vec)
+	{
+		return type_to_parser<std::vector<T>>::parse(s, vec.get());
+	}
+};
+
 /**
  * This recursive specialisation allows arbitrary nesting of vector_wrapper.
  */
@@ -41,20 +51,37 @@ struct string_to_value<vector_wrapper<T>>
 	{
 		return parse_braced_list<T>(input);
 	}
+
+	static vector_wrapper<T> parse(const char* first, const char* last)
+	{
+		return parse_braced_list<T>(first, last);
+	}
+};
+
+// Output Format: "{T, T, ...}"
+template<typename T>
+struct value_formatter<vector_wrapper<T>>
+{
+	static void format(format_buffer& out, const vector_wrapper<T>& vec)
+	{
+		const auto vec_size = vec.get().size();
+		out.append('{');
+		for (size_t i = 0; i < vec_size; ++i) {
+			out.append_value<T>(vec.get()[i]);
+			if (i < (vec_size - 1))
+				out.append(", ", 2);
+		}
+		out.append('}');
+	}
 };
 
 template<typename T>
 std::ostream& operator<<(std::ostream& out, const vector_wrapper<T>& vec)
 {
 	//std::cout << "printing vector_wrapper" << std::endl;
-	const auto vec_size = vec.get().size();
-	out << '{';
-	for (size_t i = 0; i < vec_size; ++i) {
-		out << vec.get()[i];
-		if (i < (vec_size - 1))
-			out << ", ";
-	}
-	out << '}';
+	format_buffer buffer(out);
+	buffer.append_value(vec);
+	buffer.write_to(out);
 	return out;
 }
 
@@ -62,10 +89,7 @@ template<typename T>
 std::istream& operator>>(std::istream& in, vector_wrapper<T>& vec)
 {
 	//std::cout << "parsing vector_wrapper" << std::endl;
-	std::string value;
-	std::getline(in, value);
-
-	vec.get() = parse_braced_list<T>(value);
+	vec.get() = parse_braced_list<T>(in);
 
 	return in;
 }
@@ -0,0 +1,273 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#ifndef noma_typa_view_hpp
+#define noma_typa_view_hpp
+
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <type_traits>
+
+#include "noma/typa/format.hpp"
+#include "noma/typa/matrix.hpp"
+#include "noma/typa/vector.hpp"
+
+namespace noma {
+namespace typa {
+
+/**
+ * Non-owning views of vectors and matrices in memory that belongs to someone else, e.g. a vector or
+ * matrix, a memory mapped file, or a buffer of another library. Views are cheap to copy, copies refer
+ * to the same elements, which must outlive the view.
+ * vector and matrix convert implicitly, e.g. to pass them to a function taking a view. Views of
+ * 'const T' are read-only, a view of T converts to one of 'const T'.
+ */
+
+/**
+ * 'size' elements, 'stride' elements apart, e.g. a row (stride 1) or a column (stride of the matrix)
+ * of a matrix.
+ */
+template<typename T>
+class vector_view {
+public:
+	typedef typename std::remove_const<T>::type value_type;
+
+	vector_view() = default;
+
+	vector_view(T* data, size_t size, size_t stride = 1) : data_(data), size_(size), stride_(stride) { }
+
+	// from a view of non-const elements, if T is const
+	template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+	vector_view(const vector_view<U>& other) : vector_view(other.data(), other.size(), other.stride()) { }
+
+	template<size_t Alignment, typename Allocator>
+	vector_view(vector<value_type, Alignment, Allocator>& v) : vector_view(v.data(), v.size()) { }
+
+	template<size_t Alignment, typename Allocator>
+	vector_view(const vector<value_type, Alignment, Allocator>& v) : vector_view(v.data(), v.size()) { }
+
+	// a view of a temporary would dangle
+	template<size_t Alignment, typename Allocator>
+	vector_view(vector<value_type, Alignment, Allocator>&& v) = delete;
+
+	T* data() const { return data_; }
+	size_t size() const { return size_; }
+
+	/**
+	 * Distance between consecutive elements in elements.
+	 */
+	size_t stride() const { return stride_; }
+
+	T& operator[](size_t i) const { return data_[i * stride_]; }
+
+	T& at(size_t i) const
+	{
+		assert(i < size_);
+		return data_[i * stride_];
+	}
+
+	/**
+	 * Returns the view of the 'size' elements starting at 'first'.
+	 */
+	vector_view slice(size_t first, size_t size) const
+	{
+		assert(first + size <= size_);
+		return vector_view(data_ + first * stride_, size, stride_);
+	}
+
+	/**
+	 * Write "{T,T,...}" to 'out', like vector::print().
+	 */
+	void print(std::ostream& out) const
+	{
+		out.put('{');
+		write_formatted(out, size_, sizeof(T), [&](format_buffer& buffer, size_t first, size_t last) {
+			for (size_t i = first; i < last; ++i) {
+				buffer.append_value(data_[i * stride_]);
+				if (i < size_ - 1)
+					buffer.append(',');
+			}
+		});
+		out.put('}');
+	}
+
+	void scale(value_type factor) const
+	{
+		for (size_t i = 0; i < size_; ++i)
+			data_[i * stride_] *= factor;
+	}
+
+private:
+	T* data_ = nullptr;
+	size_t size_ = 0;
+	size_t stride_ = 1;
+};
+
+/**
+ * 'rows' x 'cols' elements in row major order, the beginnings of consecutive rows are 'stride'
+ * elements apart, like the storage of matrix. Rows, columns and blocks are views into the same
+ * elements, so sub-matrices are processed without copies.
+ */
+template<typename T>
+class matrix_view {
+public:
+	typedef typename std::remove_const<T>::type value_type;
+
+	matrix_view() = default;
+
+	matrix_view(T* data, size_t rows, size_t cols, size_t stride) : data_(data), rows_(rows), cols_(cols), stride_(stride) { }
+
+	matrix_view(T* data, size_t rows, size_t cols) : matrix_view(data, rows, cols, cols) { }
+
+	// from a view of non-const elements, if T is const
+	template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+	matrix_view(const matrix_view<U>& other) : matrix_view(other.data(), other.rows(), other.cols(), other.stride()) { }
+
+	template<size_t Alignment, typename Allocator>
+	matrix_view(matrix<value_type, Alignment, Allocator>& m) : matrix_view(m.data(), m.rows(), m.cols(), m.stride()) { }
+
+	template<size_t Alignment, typename Allocator>
+	matrix_view(const matrix<value_type, Alignment, Allocator>& m) : matrix_view(m.data(), m.rows(), m.cols(), m.stride()) { }
+
+	// a view of a temporary would dangle
+	template<size_t Alignment, typename Allocator>
+	matrix_view(matrix<value_type, Alignment, Allocator>&& m) = delete;
+
+	T* data() const { return data_; }
+	size_t rows() const { return rows_; }
+	size_t cols() const { return cols_; }
+
+	/**
+	 * Leading dimension, i.e. the distance between the beginnings of consecutive rows in elements.
+	 */
+	size_t stride() const { return stride_; }
+
+	T& at(size_t i, size_t j) const
+	{
+		assert(i < rows_ && j < cols_);
+		return data_[i * stride_ + j];
+	}
+
+	vector_view<T> row(size_t i) const
+	{
+		assert(i < rows_);
+		return vector_view<T>(data_ + i * stride_, cols_);
+	}
+
+	vector_view<T> col(size_t j) const
+	{
+		assert(j < cols_);
+		return vector_view<T>(data_ + j, rows_, stride_);
+	}
+
+	/**
+	 * Returns the view of the 'rows' x 'cols' block with its upper left corner at (i, j).
+	 */
+	matrix_view block(size_t i, size_t j, size_t rows, size_t cols) const
+	{
+		assert(i + rows <= rows_ && j + cols <= cols_);
+		return matrix_view(data_ + i * stride_ + j, rows, cols, stride_);
+	}
+
+	/**
+	 * Write "{{T,T,...},...}" to 'out', like matrix::print().
+	 */
+	void print(std::ostream& out) const
+	{
+		out.put('{');
+		if (cols_ == 0) { // no elements to write the braces of the rows with
+			for (size_t i = 0; i < rows_; ++i)
+				out << ((i == 0) ? "{}" : ",{}");
+			out.put('}');
+			return;
+		}
+		write_elements(out, [&](format_buffer& buffer, size_t i, size_t j) {
+			if (j == 0)
+				buffer.append('{');
+			buffer.append_value(at(i, j));
+			if (j < cols_ - 1) {
+				buffer.append(',');
+			} else {
+				buffer.append('}');
+				if (i < rows_ - 1)
+					buffer.append(',');
+			}
+		});
+		out.put('}');
+	}
+
+	/**
+	 * Write the elements row by row, one row per line, separated by 'delimiter', like
+	 * matrix::print_raw().
+	 */
+	void print_raw(std::ostream& out, const char& delimiter = '\t') const
+	{
+		write_elements(out, [&](format_buffer& buffer, size_t i, size_t j) {
+			buffer.append_value(at(i, j));
+			buffer.append((j == cols_ - 1) ? '\n' : delimiter);
+		});
+	}
+
+	void scale(value_type factor) const
+	{
+		for (size_t i = 0; i < rows_; ++i) {
+			T* row = data_ + i * stride_;
+			for (size_t j = 0; j < cols_; ++j)
+				row[j] *= factor;
+		}
+	}
+
+private:
+	/**
+	 * Write all elements in row-major order via write_formatted(), see matrix::write_elements().
+	 */
+	template<typename F>
+	void write_elements(std::ostream& out, F format_element) const
+	{
+		write_formatted(out, rows_ * cols_, sizeof(T), [&](format_buffer& buffer, size_t first, size_t last) {
+			size_t i = first / cols_;
+			size_t j = first % cols_;
+			for (size_t k = first; k < last; ++k) {
+				format_element(buffer, i, j);
+				if (++j == cols_) {
+					j = 0;
+					++i;
+				}
+			}
+		});
+	}
+
+	T* data_ = nullptr;
+	size_t rows_ = 0;
+	size_t cols_ = 0;
+	size_t stride_ = 0;
+};
+
+template<typename T>
+struct expression_operand<matrix_view<T>>
+{
+	static const bool value = true;
+	typedef array_expression<typename matrix_view<T>::value_type, 2> type;
+	static type make(const matrix_view<T>& m) { return type(m.data(), m.rows(), m.cols(), m.stride()); }
+};
+
+template<typename T>
+std::ostream& operator<<(std::ostream& out, const vector_view<T>& v)
+{
+	v.print(out);
+	return out;
+}
+
+template<typename T>
+std::ostream& operator<<(std::ostream& out, const matrix_view<T>& m)
+{
+	m.print(out);
+	return out;
+}
+
+} // namespace typa
+} // namespace noma
+
+#endif // noma_typa_view_hpp
@@ -0,0 +1,325 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "noma/typa/typa.hpp"
+
+using namespace noma::typa;
+using real_t = double;
+
+/**
+ * Runs 'func' 'repetitions' times and returns the average time per call in nanoseconds.
+ */
+template<typename F>
+double time_per_call_ns(size_t repetitions, F func)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < repetitions; ++i)
+		func();
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / repetitions;
+}
+
+void print_result(const std::string& name, double ns_per_call)
+{
+	std::cout << name << ": " << ns_per_call << " ns/call" << std::endl;
+}
+
+/**
+ * Per-call cost of the regular expressions for short vector_wrapper<real_t> inputs, compiled on
+ * every call (as parse_braced_list() used to do) vs. taken from the compiled_regexp cache.
+ */
+void bench_regexp_cache(size_t repetitions)
+{
+	const std::string input { "{1.0, 2.5e-3, -3.25}" };
+	size_t matches = 0; // keep the optimiser from dropping the work
+
+	print_result("regexp compiled per call", time_per_call_ns(repetitions, [&]() {
+		const std::regex list_exp { type_to_regexp<vector_wrapper<real_t>>::exp_str() };
+		const std::regex entry_exp { type_to_regexp<real_t>::exp_str() };
+		matches += std::regex_match(remove_whitespace(input), list_exp);
+	}));
+
+	print_result("regexp from cache", time_per_call_ns(repetitions, [&]() {
+		matches += regexp_match<vector_wrapper<real_t>>(input);
+	}));
+
+	print_result("parse_braced_list<real_t>", time_per_call_ns(repetitions, [&]() {
+		matches += parse_braced_list<real_t>(input).size();
+	}));
+
+	if (matches == 0)
+		std::cout << "unexpected: no matches" << std::endl;
+}
+
+/**
+ * Throughput of the structural index and of remove_whitespace() on a large matrix literal.
+ */
+void bench_structural_index(size_t rows, size_t cols)
+{
+	std::string input { "{" };
+	for (size_t i = 0; i < rows; ++i) {
+		input += (i == 0) ? "{" : ",\n {";
+		for (size_t j = 0; j < cols; ++j)
+			input += ((j == 0) ? "" : ", ") + std::to_string(i * cols + j) + ".125e-3";
+		input += "}";
+	}
+	input += "}";
+
+	const double gigabytes = input.size() / 1e9;
+	size_t count = 0;
+	std::vector<const char*> positions;
+	positions.reserve(rows * cols + rows + 2);
+
+	const double find_ns = time_per_call_ns(10, [&]() {
+		positions.clear();
+		find_structurals(input.data(), input.data() + input.size(), positions);
+		count += positions.size();
+	});
+	std::cout << "find_structurals (" << structural_index_implementation() << "): " << gigabytes / (find_ns * 1e-9) << " GB/s" << std::endl;
+
+	const double remove_ns = time_per_call_ns(10, [&]() {
+		count += remove_whitespace(static_cast<const std::string&>(input)).size();
+	});
+	std::cout << "remove_whitespace (" << structural_index_implementation() << "): " << gigabytes / (remove_ns * 1e-9) << " GB/s" << std::endl;
+
+	const double parse_ns = time_per_call_ns(1, [&]() {
+		count += string_to_value<matrix<real_t>>::parse(input).rows();
+	});
+	std::cout << "parse matrix<real_t> " << rows << "x" << cols << ": " << gigabytes / (parse_ns * 1e-9) << " GB/s" << std::endl;
+
+	if (count == 0)
+		std::cout << "unexpected: nothing found" << std::endl;
+}
+
+/**
+ * Per-value cost of boost::lexical_cast vs. string_to_value, which uses number.hpp, for reals and integers.
+ */
+void bench_number_conversion(size_t count)
+{
+	std::vector<std::string> reals, integers;
+	for (size_t i = 0; i < count; ++i) {
+		reals.push_back(std::to_string(i * 7919 % 100003) + "." + std::to_string(i % 997) + "e-" + std::to_string(i % 20));
+		integers.push_back(std::to_string(static_cast<long>(i * 2654435761u % 4000000007u) - 2000000000));
+	}
+	double sum = 0.0; // keep the optimiser from dropping the work
+
+	print_result("boost::lexical_cast<real_t>", time_per_call_ns(1, [&]() {
+		for (const auto& r : reals)
+			sum += boost::lexical_cast<real_t>(r);
+	}) / count);
+	print_result("string_to_value<real_t>", time_per_call_ns(1, [&]() {
+		for (const auto& r : reals)
+			sum += string_to_value<real_t>::parse(r);
+	}) / count);
+	print_result("boost::lexical_cast<long>", time_per_call_ns(1, [&]() {
+		for (const auto& i : integers)
+			sum += boost::lexical_cast<long>(i);
+	}) / count);
+	print_result("string_to_value<long>", time_per_call_ns(1, [&]() {
+		for (const auto& i : integers)
+			sum += string_to_value<long>::parse(i);
+	}) / count);
+
+	if (sum == 0.0)
+		std::cout << "unexpected: zero sum" << std::endl;
+}
+
+/**
+ * Throughput of parse_braced_list<real_t>() on a large flat list, serial vs. parallel.
+ */
+void bench_parallel_braced_list(size_t count)
+{
+	std::string input { "{" };
+	for (size_t i = 0; i < count; ++i)
+		input += ((i == 0) ? "" : ", ") + std::to_string(i * 7919 % 100003) + ".125e-3";
+	input += "}";
+	const double gigabytes = input.size() / 1e9;
+	size_t parsed = 0;
+
+	const size_t hardware_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	for (size_t threads = 1; threads <= hardware_threads; threads *= 2) {
+		set_thread_count(threads);
+		const double parse_ns = time_per_call_ns(3, [&]() {
+			parsed += parse_braced_list<real_t>(input).size();
+		});
+		std::cout << "parse_braced_list<real_t> " << count << " entries, " << threads << " thread(s): " << gigabytes / (parse_ns * 1e-9) << " GB/s" << std::endl;
+	}
+	set_thread_count(1);
+
+	if (parsed == 0)
+		std::cout << "unexpected: nothing parsed" << std::endl;
+}
+
+/**
+ * Parsing a matrix<real_t> list literal from a string and from a stream.
+ */
+void bench_matrix_list(size_t rows, size_t cols)
+{
+	std::ostringstream oss;
+	oss << matrix<real_t>(rows, cols, 0.125);
+	const std::string input { oss.str() };
+	const double gigabytes = input.size() / 1e9;
+	size_t parsed = 0;
+
+	const double string_ns = time_per_call_ns(3, [&]() {
+		parsed += string_to_value<matrix<real_t>>::parse(input).rows();
+	});
+	std::cout << "string_to_value<matrix<real_t>> " << rows << "x" << cols << ": " << gigabytes / (string_ns * 1e-9) << " GB/s" << std::endl;
+	const double stream_ns = time_per_call_ns(3, [&]() {
+		std::istringstream in(input);
+		matrix<real_t> m;
+		in >> m;
+		parsed += m.rows();
+	});
+	std::cout << "operator>>(matrix<real_t>) " << rows << "x" << cols << ": " << gigabytes / (stream_ns * 1e-9) << " GB/s" << std::endl;
+
+	if (parsed == 0)
+		std::cout << "unexpected: nothing parsed" << std::endl;
+}
+
+/**
+ * Effective bandwidth (bytes read + written) of matrix<real_t>::transposed() and transpose() vs. a
+ * plain memcpy() of the same data and the former element by element loop, and with padded rows,
+ * which avoids the power of two stride of the result.
+ */
+void bench_transpose(size_t n)
+{
+	matrix<real_t> m(n, n + 1, 1.0);
+	matrix<real_t> square(n, n, 1.0);
+	const matrix<real_t> padded(n, n + 1, 1.0, true);
+	std::vector<real_t> copy(n * (n + 1));
+	const double gigabytes = 2.0 * n * (n + 1) * sizeof(real_t) / 1e9;
+	auto print_bandwidth = [&](const std::string& name, double ns) {
+		std::cout << name << " " << n << "x" << (n + 1) << ": " << gigabytes / (ns * 1e-9) << " GB/s" << std::endl;
+	};
+	real_t sum = 0.0;
+
+	print_bandwidth("memcpy baseline", time_per_call_ns(5, [&]() {
+		std::memcpy(copy.data(), m.data(), copy.size() * sizeof(real_t));
+		sum += copy[n];
+	}));
+	print_bandwidth("element by element transpose", time_per_call_ns(5, [&]() {
+		for (size_t i = 0; i < m.rows(); ++i)
+			for (size_t j = 0; j < m.cols(); ++j)
+				copy[j * m.rows() + i] = m.at(i, j);
+		sum += copy[n];
+	}));
+	const size_t hardware_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	for (size_t threads = 1; threads <= hardware_threads; threads *= 2) {
+		set_thread_count(threads);
+		print_bandwidth("matrix::transposed(), " + std::to_string(threads) + " thread(s)", time_per_call_ns(5, [&]() {
+			sum += m.transposed().at(n, 0);
+		}));
+		print_bandwidth("matrix::transposed() padded, " + std::to_string(threads) + " thread(s)", time_per_call_ns(5, [&]() {
+			sum += padded.transposed().at(n, 0);
+		}));
+		print_bandwidth("matrix::transpose() in place, " + std::to_string(threads) + " thread(s)", time_per_call_ns(5, [&]() {
+			square.transpose();
+			sum += square.at(0, 1);
+		}) * (n + 1) / n);
+	}
+	set_thread_count(1);
+
+	if (sum == 0.0)
+		std::cout << "unexpected: zero sum" << std::endl;
+}
+
+/**
+ * Effective bandwidth of y = a * x + b * z: as a fused expression template, as a hand-written loop, and
+ * with temporaries, i.e. the scale() and copy based way it had to be written before.
+ */
+void bench_expression(size_t n)
+{
+	const real_t a = 0.5, b = 2.0;
+	vector<real_t> x(n, 1.0), z(n, 2.0), y(n), tmp(n);
+	const double gigabytes = 3.0 * n * sizeof(real_t) / 1e9;
+	auto print_bandwidth = [&](const std::string& name, double ns) {
+		std::cout << name << " " << n << " elements: " << gigabytes / (ns * 1e-9) << " GB/s" << std::endl;
+	};
+	real_t sum = 0.0;
+
+	print_bandwidth("y = a * x + b * z, hand-written loop", time_per_call_ns(20, [&]() {
+		for (size_t i = 0; i < n; ++i)
+			y[i] = a * x[i] + b * z[i];
+		sum += y[n - 1];
+	}));
+	print_bandwidth("y = a * x + b * z, expression template", time_per_call_ns(20, [&]() {
+		y = a * x + b * z;
+		sum += y[n - 1];
+	}));
+	print_bandwidth("y = a * x + b * z, temporaries", time_per_call_ns(20, [&]() {
+		y = x;
+		y.scale(a);
+		tmp = z;
+		tmp.scale(b);
+		for (size_t i = 0; i < n; ++i)
+			y.at(i) += tmp.at(i);
+		sum += y[n - 1];
+	}));
+
+	if (sum == 0.0)
+		std::cout << "unexpected: zero sum" << std::endl;
+}
+
+void bench_print(size_t rows, size_t cols)
+{
+	matrix<real_t> m(rows, cols);
+	std::mt19937_64 rng(42);
+	std::uniform_real_distribution<real_t> dist(-1000.0, 1000.0);
+	for (size_t i = 0; i < rows; ++i)
+		for (size_t j = 0; j < cols; ++j)
+			m.at(i, j) = dist(rng);
+	size_t output_size = 0;
+	auto print_throughput = [&](const std::string& name, double ns) {
+		std::cout << name << " " << rows << "x" << cols << " matrix: " << (rows * cols) / (ns * 1e-9) / 1e6 << " M values/s, " << output_size << " bytes" << std::endl;
+	};
+
+	print_throughput("Print, std::ostream with max_digits10", time_per_call_ns(3, [&]() {
+		std::ostringstream oss;
+		oss << std::scientific << std::setprecision(std::numeric_limits<real_t>::max_digits10);
+		oss << '{';
+		for (size_t i = 0; i < rows; ++i) {
+			oss << '{';
+			for (size_t j = 0; j < cols; ++j)
+				oss << m.at(i, j) << ((j + 1 < cols) ? "," : "");
+			oss << ((i + 1 < rows) ? "}," : "}");
+		}
+		oss << '}';
+		output_size = oss.str().size();
+	}));
+	print_throughput("Print, shortest round trip", time_per_call_ns(3, [&]() {
+		std::ostringstream oss;
+		oss << m;
+		output_size = oss.str().size();
+	}));
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t repetitions = (argc > 1) ? std::stoul(argv[1]) : 10000;
+
+	bench_regexp_cache(repetitions);
+	bench_number_conversion(1000000);
+	bench_structural_index(1000, 1000);
+	bench_parallel_braced_list(10000000);
+	bench_matrix_list(10000, 100);
+	bench_transpose(4096);
+	bench_expression(10000000);
+	bench_print(1000, 1000);
+
+	return 0;
+}
@@ -0,0 +1,531 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+/**
+ * Benchmark suite for tracking performance between releases: parse throughput per leaf type, nesting
+ * depth (nested std::vector and tensor) and container over a range of input sizes, the file
+ * protocols, sparse matrices, printing and transposed().
+ * Inputs are generated from a fixed seed, results are written as JSON.
+ *
+ * Usage: bench_suite [--max-size BYTES] [--runs N] [--threads N] [--filter TEXT] [--output FILE]
+ *     --max-size  largest input in bytes, sizes grow by 8x from 64 bytes (default 16 MiB),
+ *                 e.g. 1073741824 for gigabyte inputs
+ *     --runs      minimum number of timed runs per benchmark (default 5), more runs are done
+ *                 within min_seconds_per_benchmark for small inputs
+ *     --threads   see set_thread_count() (default 1)
+ *     --filter    only run benchmarks whose name contains TEXT
+ *     --output    write the JSON to FILE instead of stdout, progress goes to stderr
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "noma/typa/typa.hpp"
+
+using namespace noma::typa;
+using int_t = int;
+using real_t = double;
+using complex_t = std::complex<real_t>;
+
+const double min_seconds_per_benchmark = 0.2;
+const size_t min_input_size = 64;
+const size_t size_factor = 8;
+
+/**
+ * Command line options, see above.
+ */
+struct options
+{
+	size_t max_size = 16 * 1024 * 1024;
+	size_t runs = 5;
+	size_t threads = 1;
+	std::string filter;
+	std::string output;
+};
+
+options parse_options(int argc, char* argv[])
+{
+	options opts;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg { argv[i] };
+		if (i + 1 == argc)
+			throw std::invalid_argument("missing value for " + arg);
+		const std::string value { argv[++i] };
+		if (arg == "--max-size")
+			opts.max_size = std::stoull(value);
+		else if (arg == "--runs")
+			opts.runs = std::max<size_t>(std::stoull(value), 1);
+		else if (arg == "--threads")
+			opts.threads = std::stoull(value);
+		else if (arg == "--filter")
+			opts.filter = value;
+		else if (arg == "--output")
+			opts.output = value;
+		else
+			throw std::invalid_argument("unknown option " + arg);
+	}
+	return opts;
+}
+
+/**
+ * Synthetic literals, deterministic for a given seed. append(out, T*) appends one literal of type T,
+ * the pointer only selects the overload.
+ */
+class input_generator
+{
+public:
+	explicit input_generator(uint64_t seed = 42) : rng_(seed) { }
+
+	void append(std::string& out, const int_t*)
+	{
+		out += std::to_string(std::uniform_int_distribution<int_t>(-1000000, 1000000)(rng_));
+	}
+
+	void append(std::string& out, const real_t*)
+	{
+		// mantissas of all lengths, exponents that select fixed and scientific notation
+		const real_t value = std::uniform_real_distribution<real_t>(-1.0, 1.0)(rng_) * std::pow(10.0, std::uniform_int_distribution<int>(-8, 8)(rng_));
+		char digits[max_number_chars];
+		out.append(digits, format_real(value, digits));
+	}
+
+	void append(std::string& out, const complex_t*)
+	{
+		out += '(';
+		append(out, static_cast<const real_t*>(nullptr));
+		out += ',';
+		append(out, static_cast<const real_t*>(nullptr));
+		out += ')';
+	}
+
+	void append(std::string& out, const std::string*)
+	{
+		const size_t length = std::uniform_int_distribution<size_t>(1, 16)(rng_);
+		for (size_t i = 0; i < length; ++i)
+			out += static_cast<char>('a' + std::uniform_int_distribution<int>(0, 25)(rng_));
+	}
+
+	template<typename T1, typename T2>
+	void append(std::string& out, const pair_wrapper<T1, T2>*)
+	{
+		out += '(';
+		append(out, static_cast<const T1*>(nullptr));
+		out += ", ";
+		append(out, static_cast<const T2*>(nullptr));
+		out += ')';
+	}
+
+	/**
+	 * Append a braced list of 'count' T, separated by ", ".
+	 */
+	template<typename T>
+	void append_list(std::string& out, size_t count)
+	{
+		out += '{';
+		for (size_t i = 0; i < count; ++i) {
+			if (i > 0)
+				out += ", ";
+			append(out, static_cast<const T*>(nullptr));
+		}
+		out += '}';
+	}
+
+	/**
+	 * Braced list with nesting 'depth' (1 for a flat list), 'fan_out' entries per inner list, and as
+	 * many top-level entries as needed to reach 'size' bytes. Returns the number of leaf elements.
+	 */
+	template<typename T>
+	size_t nested_list(std::string& out, size_t size, size_t depth, size_t fan_out)
+	{
+		size_t elements = 0;
+		out = "{";
+		while (out.size() < size) {
+			if (out.size() > 1)
+				out += ", ";
+			elements += append_nested<T>(out, depth - 1, fan_out);
+		}
+		out += '}';
+		return elements;
+	}
+
+private:
+	template<typename T>
+	size_t append_nested(std::string& out, size_t depth, size_t fan_out)
+	{
+		if (depth == 0) {
+			append(out, static_cast<const T*>(nullptr));
+			return 1;
+		}
+		size_t elements = 0;
+		out += '{';
+		for (size_t i = 0; i < fan_out; ++i) {
+			if (i > 0)
+				out += ", ";
+			elements += append_nested<T>(out, depth - 1, fan_out);
+		}
+		out += '}';
+		return elements;
+	}
+
+	std::mt19937_64 rng_;
+};
+
+/**
+ * Output stream buffer discarding everything, to measure printing without storing gigabytes.
+ */
+class null_buffer : public std::streambuf
+{
+protected:
+	std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+	int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+};
+
+struct result
+{
+	std::string name;
+	size_t bytes; // input (or output) size the throughput refers to
+	size_t elements;
+	size_t runs;
+	double min_ns;
+	double median_ns;
+};
+
+/**
+ * Runs the benchmarks, collects the results and writes them as JSON.
+ */
+class suite
+{
+public:
+	explicit suite(const options& opts) : opts_(opts) { }
+
+	bool enabled(const std::string& name) const
+	{
+		return opts_.filter.empty() || name.find(opts_.filter) != std::string::npos;
+	}
+
+	/**
+	 * Time 'func' for at least opts.runs runs and min_seconds_per_benchmark.
+	 */
+	template<typename F>
+	void run(const std::string& name, size_t bytes, size_t elements, F func)
+	{
+		if (!enabled(name))
+			return;
+		func(); // warm up, e.g. page faults of the result
+
+		std::vector<double> times;
+		double total_ns = 0.0;
+		while (times.size() < opts_.runs || total_ns < min_seconds_per_benchmark * 1e9) {
+			const auto start = std::chrono::steady_clock::now();
+			func();
+			const auto end = std::chrono::steady_clock::now();
+			times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+			total_ns += times.back();
+		}
+		std::sort(times.begin(), times.end());
+		results_.push_back({ name, bytes, elements, times.size(), times.front(), times[times.size() / 2] });
+		std::cerr << name << " " << bytes << " bytes: " << bytes / (times.front() * 1e-9) / 1e6 << " MB/s" << std::endl;
+	}
+
+	void write_json(std::ostream& out) const
+	{
+		out << "{\n";
+		out << "  \"threads\": " << thread_count() << ",\n";
+		out << "  \"structural_index\": \"" << structural_index_implementation() << "\",\n";
+		out << "  \"results\": [\n";
+		for (size_t i = 0; i < results_.size(); ++i) {
+			const result& r = results_[i];
+			out << "    { \"name\": \"" << r.name << "\", \"bytes\": " << r.bytes << ", \"elements\": " << r.elements
+			    << ", \"runs\": " << r.runs << ", \"min_ns\": " << r.min_ns << ", \"median_ns\": " << r.median_ns
+			    << ", \"mb_per_s\": " << r.bytes / (r.min_ns * 1e-9) / 1e6
+			    << ", \"elements_per_s\": " << r.elements / (r.min_ns * 1e-9) << " }"
+			    << ((i + 1 < results_.size()) ? ",\n" : "\n");
+		}
+		out << "  ]\n";
+		out << "}\n";
+	}
+
+	const options& opts() const { return opts_; }
+
+private:
+	options opts_;
+	std::vector<result> results_;
+};
+
+/**
+ * Sizes from min_input_size to opts.max_size, growing by size_factor.
+ */
+std::vector<size_t> input_sizes(const options& opts)
+{
+	std::vector<size_t> sizes;
+	for (size_t size = min_input_size; size <= opts.max_size; size *= size_factor)
+		sizes.push_back(size);
+	return sizes;
+}
+
+template<typename Container>
+size_t container_size(const Container& c) { return c.size(); }
+
+template<typename T>
+size_t container_size(const vector_wrapper<T>& w) { return w.get().size(); }
+
+/**
+ * Parse a generated list of 'size' bytes as Container, whose leaves are T.
+ */
+template<typename Container, typename T>
+void bench_parse(suite& s, const std::string& name, size_t size, size_t depth, size_t fan_out)
+{
+	if (!s.enabled(name))
+		return;
+	input_generator generator;
+	std::string input;
+	const size_t elements = generator.nested_list<T>(input, size, depth, fan_out);
+	s.run(name, input.size(), elements, [&]() {
+		const Container value = string_to_value<Container>::parse(input);
+		if (container_size(value) == 0)
+			throw std::logic_error(name + ": nothing parsed");
+	});
+}
+
+void bench_leaf_types(suite& s)
+{
+	for (size_t size : input_sizes(s.opts())) {
+		bench_parse<std::vector<int_t>, int_t>(s, "parse/leaf/int", size, 1, 0);
+		bench_parse<std::vector<real_t>, real_t>(s, "parse/leaf/double", size, 1, 0);
+		bench_parse<std::vector<complex_t>, complex_t>(s, "parse/leaf/complex", size, 1, 0);
+		bench_parse<std::vector<std::string>, std::string>(s, "parse/leaf/string", size, 1, 0);
+	}
+}
+
+void bench_nesting(suite& s)
+{
+	for (size_t size : input_sizes(s.opts())) {
+		bench_parse<std::vector<real_t>, real_t>(s, "parse/depth/1", size, 1, 8);
+		bench_parse<std::vector<std::vector<real_t>>, real_t>(s, "parse/depth/2", size, 2, 8);
+		bench_parse<std::vector<std::vector<std::vector<real_t>>>, real_t>(s, "parse/depth/3", size, 3, 8);
+		bench_parse<tensor<real_t, 3>, real_t>(s, "parse/depth/3/tensor", size, 3, 8);
+	}
+}
+
+/**
+ * Map with about 'size' bytes of input, unique ascending integer keys and generated values.
+ */
+template<typename Map>
+void bench_parse_map(suite& s, const std::string& name, size_t size)
+{
+	if (!s.enabled(name))
+		return;
+	input_generator generator;
+	std::string input { "{" };
+	size_t elements = 0;
+	while (input.size() < size) {
+		if (input.size() > 1)
+			input += ", ";
+		input += "(" + std::to_string(elements++) + ", ";
+		generator.append(input, static_cast<const real_t*>(nullptr));
+		input += ')';
+	}
+	input += '}';
+	s.run(name, input.size(), elements, [&]() {
+		const Map value = string_to_value<Map>::parse(input);
+		if (value.size() != elements)
+			throw std::logic_error(name + ": wrong number of entries");
+	});
+}
+
+void bench_containers(suite& s)
+{
+	for (size_t size : input_sizes(s.opts())) {
+		bench_parse<vector<real_t>, real_t>(s, "parse/container/vector", size, 1, 0);
+		bench_parse<vector_wrapper<real_t>, real_t>(s, "parse/container/vector_wrapper", size, 1, 0);
+		bench_parse<std::vector<pair_wrapper<int_t, real_t>>, pair_wrapper<int_t, real_t>>(s, "parse/container/pair_wrapper", size, 1, 0);
+
+		bench_parse_map<std::map<int_t, real_t>>(s, "parse/container/map", size);
+		bench_parse_map<std::unordered_map<int_t, real_t>>(s, "parse/container/unordered_map", size);
+
+		const std::string name { "parse/container/matrix" };
+		if (!s.enabled(name))
+			continue;
+		// square-ish matrix: rows of 'cols' generated doubles (about 20 bytes each)
+		const size_t cols = std::max<size_t>(static_cast<size_t>(std::sqrt(size / 20.0)), 1);
+		input_generator generator;
+		std::string input { "{" };
+		size_t elements = 0;
+		while (input.size() < size) {
+			if (input.size() > 1)
+				input += ", ";
+			generator.append_list<real_t>(input, cols);
+			elements += cols;
+		}
+		input += '}';
+		s.run(name, input.size(), elements, [&]() {
+			const matrix<real_t> m = string_to_value<matrix<real_t>>::parse(input);
+			if (m.rows() == 0)
+				throw std::logic_error(name + ": nothing parsed");
+		});
+	}
+}
+
+/**
+ * Square matrix with about 'size' bytes of elements, filled with generated values.
+ */
+matrix<real_t> make_matrix(size_t size)
+{
+	const size_t n = std::max<size_t>(static_cast<size_t>(std::sqrt(size / sizeof(real_t))), 1);
+	matrix<real_t> m(n, n);
+	std::mt19937_64 rng(42);
+	std::uniform_real_distribution<real_t> dist(-1000.0, 1000.0);
+	for (size_t i = 0; i < n; ++i)
+		for (size_t j = 0; j < n; ++j)
+			m.at(i, j) = dist(rng);
+	return m;
+}
+
+void bench_files(suite& s)
+{
+	const std::string text_filename { "bench_suite_tmp.txt" };
+	const std::string npy_filename { "bench_suite_tmp.npy" };
+	for (size_t size : input_sizes(s.opts())) {
+		if (!s.enabled("file/text/matrix") && !s.enabled("file/npy/matrix"))
+			break;
+		const matrix<real_t> m = make_matrix(size);
+		const size_t elements = m.rows() * m.cols();
+		{
+			std::ofstream file(text_filename);
+			file << m.rows() << " " << m.cols() << "\n";
+			m.print_raw(file, ' ');
+		}
+		m.save_npy(npy_filename);
+		const size_t text_size = std::ifstream(text_filename, std::ios::binary | std::ios::ate).tellg();
+		const size_t npy_size = std::ifstream(npy_filename, std::ios::binary | std::ios::ate).tellg();
+
+		matrix<real_t> result;
+		s.run("file/text/matrix", text_size, elements, [&]() {
+			std::istringstream(text_filename) >> result;
+		});
+		s.run("file/npy/matrix", npy_size, elements, [&]() {
+			std::istringstream(npy_filename) >> result;
+		});
+	}
+	std::remove(text_filename.c_str());
+	std::remove(npy_filename.c_str());
+}
+
+/**
+ * Sparse matrices with 8 nonzeros in random columns per row, about 'size' bytes as .mtx file: loading
+ * via the file protocol and the sparse matrix-vector product.
+ */
+void bench_sparse(suite& s)
+{
+	const std::string mtx_filename { "bench_suite_tmp.mtx" };
+	const size_t per_row = 8;
+	for (size_t size : input_sizes(s.opts())) {
+		if (!s.enabled("file/mtx/sparse_matrix") && !s.enabled("spmv/sparse_matrix"))
+			break;
+		const size_t n = std::max<size_t>(size / (per_row * 24), 1);
+		std::mt19937_64 rng(42);
+		std::uniform_real_distribution<real_t> dist(-1.0, 1.0);
+		std::vector<sparse_entry<real_t>> entries;
+		for (size_t i = 0; i < n; ++i)
+			for (size_t k = 0; k < per_row; ++k)
+				entries.push_back({ i, static_cast<size_t>(rng() % n), dist(rng) });
+		sparse_matrix<real_t> m;
+		m.assign(n, n, entries);
+		{
+			std::ofstream file(mtx_filename);
+			file << "%%MatrixMarket matrix coordinate real general\n" << n << " " << n << " " << m.nonzeros() << "\n";
+			char digits[max_number_chars];
+			for (size_t i = 0; i < n; ++i) {
+				for (size_t k = m.row_offsets()[i]; k < m.row_offsets()[i + 1]; ++k) {
+					file << i + 1 << " " << m.col_indices()[k] + 1 << " ";
+					file.write(digits, format_real(m.values()[k], digits) - digits);
+					file << "\n";
+				}
+			}
+		}
+		const size_t mtx_size = std::ifstream(mtx_filename, std::ios::binary | std::ios::ate).tellg();
+
+		sparse_matrix<real_t> result;
+		s.run("file/mtx/sparse_matrix", mtx_size, m.nonzeros(), [&]() {
+			std::istringstream(mtx_filename) >> result;
+		});
+		const vector<real_t> x(n, 1.0);
+		vector<real_t> y;
+		s.run("spmv/sparse_matrix", m.nonzeros() * (sizeof(real_t) + sizeof(size_t)), m.nonzeros(), [&]() {
+			m.multiply(x, y);
+		});
+	}
+	std::remove(mtx_filename.c_str());
+}
+
+void bench_print(suite& s)
+{
+	null_buffer discard;
+	std::ostream out(&discard);
+	for (size_t size : input_sizes(s.opts())) {
+		if (!s.enabled("print/matrix"))
+			break;
+		const matrix<real_t> m = make_matrix(size);
+		std::ostringstream sample;
+		sample << m;
+		s.run("print/matrix", sample.str().size(), m.rows() * m.cols(), [&]() {
+			out << m;
+		});
+	}
+}
+
+void bench_transposed(suite& s)
+{
+	for (size_t size : input_sizes(s.opts())) {
+		if (!s.enabled("transposed/matrix"))
+			break;
+		const matrix<real_t> m = make_matrix(size);
+		s.run("transposed/matrix", m.rows() * m.cols() * sizeof(real_t), m.rows() * m.cols(), [&]() {
+			const matrix<real_t> t = m.transposed();
+			if (t.rows() != m.cols())
+				throw std::logic_error("transposed/matrix: wrong shape");
+		});
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try {
+		const options opts = parse_options(argc, argv);
+		set_thread_count(opts.threads);
+		suite s(opts);
+
+		bench_leaf_types(s);
+		bench_nesting(s);
+		bench_containers(s);
+		bench_files(s);
+		bench_sparse(s);
+		bench_print(s);
+		bench_transposed(s);
+
+		if (opts.output.empty()) {
+			s.write_json(std::cout);
+		} else {
+			std::ofstream out(opts.output);
+			s.write_json(out);
+		}
+	} catch (std::exception& e) {
+		std::cerr << "bench_suite: error: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include "noma/typa/aligned_memory.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#include "noma/typa/stats.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define NOMA_TYPA_POSIX_MEMALIGN
+#elif defined(_WIN32)
+	#include <malloc.h>
+#endif
+
+namespace noma {
+namespace typa {
+
+// see header for explanation
+void* allocate_aligned(size_t size, size_t alignment)
+{
+	if (size == 0)
+		size = 1; // unique pointer, like new T[0]
+	NOMA_TYPA_STATS_ALLOCATION(size);
+	alignment = std::max(alignment, sizeof(void*)); // as required by posix_memalign()
+#if defined(NOMA_TYPA_POSIX_MEMALIGN)
+	void* ptr = nullptr;
+	if (::posix_memalign(&ptr, alignment, size) != 0)
+		throw std::bad_alloc();
+	return ptr;
+#elif defined(_WIN32)
+	void* ptr = ::_aligned_malloc(size, alignment);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+#else
+	// over-allocate and keep the original pointer right in front of the aligned block
+	void* raw = std::malloc(size + alignment + sizeof(void*));
+	if (!raw)
+		throw std::bad_alloc();
+	const uintptr_t first = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+	void** aligned = reinterpret_cast<void**>((first + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+	aligned[-1] = raw;
+	return aligned;
+#endif
+}
+
+// see header for explanation
+void deallocate_aligned(void* ptr)
+{
+	if (!ptr)
+		return;
+#if defined(NOMA_TYPA_POSIX_MEMALIGN)
+	std::free(ptr);
+#elif defined(_WIN32)
+	::_aligned_free(ptr);
+#else
+	std::free(static_cast<void**>(ptr)[-1]);
+#endif
+}
+
+} // namespace typa
+} // namespace noma
@@ -4,6 +4,8 @@
 
 #include "noma/typa/braced_list.hpp"
 
+#include "noma/typa/structural_index.hpp"
+
 namespace noma {
 namespace typa {
 
@@ -13,5 +15,35 @@ std::string make_braced_list(const std::string& entry_exp)
 	return R"(\{(?:)" + entry_exp + R"()(?:,)" + entry_exp + R"()*\})";
 }
 
+// see header for explanation
+size_t count_list_entries(const char* first, const char* last)
+{
+	NOMA_TYPA_STATS_PHASE(validation, last - first);
+	const char* list_first = skip_whitespace(first, last);
+	if (list_first == last || *list_first != '{')
+		return 0;
+
+	// top-level commas, up to the closing brace
+	structural_index index(list_first + 1, last);
+	size_t depth = 0;
+	size_t commas = 0;
+	for (const char* pos = index.next(list_first + 1); pos != last; pos = index.next(pos + 1)) {
+		switch (*pos) {
+			case '{': case '(':
+				++depth;
+				break;
+			case '}': case ')':
+				if (depth == 0)
+					return (pos == skip_whitespace(list_first + 1, last)) ? 0 : commas + 1;
+				--depth;
+				break;
+			default: // ','
+				if (depth == 0)
+					++commas;
+		}
+	}
+	return commas + 1;
+}
+
 } // namespace typa
 } // namespace noma
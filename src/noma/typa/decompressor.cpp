@@ -0,0 +1,280 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include "noma/typa/decompressor.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#ifdef NOMA_TYPA_GZIP
+	#include <zlib.h>
+#endif
+#ifdef NOMA_TYPA_ZSTD
+	#include <zstd.h>
+#endif
+
+#include "noma/typa/parser_error.hpp"
+#include "noma/typa/stats.hpp"
+#include "noma/typa/util.hpp"
+
+namespace noma {
+namespace typa {
+
+namespace detail {
+
+/**
+ * Decoder of one compression format, reads from [first, last) given on construction.
+ */
+class decompression_stream
+{
+public:
+	virtual ~decompression_stream() = default;
+
+	/**
+	 * Decompress up to 'size' bytes into 'out', returns the number of bytes written, which is only 0
+	 * at the end of the data. Throws parser_error on corrupt or truncated data.
+	 */
+	virtual size_t read(char* out, size_t size) = 0;
+};
+
+} // namespace detail
+
+namespace {
+
+#ifdef NOMA_TYPA_GZIP
+// also handles files of several concatenated gzip members, like gunzip
+class gzip_stream : public detail::decompression_stream
+{
+public:
+	gzip_stream(const std::string& filename, const char* first, const char* last) : filename_(filename), next_(first), last_(last)
+	{
+		if (inflateInit2(&z_, 15 + 16) != Z_OK) // 15 + 16: gzip header, maximum window
+			throw parser_error("noma::typa::gzip_stream::gzip_stream(): error: could not initialise zlib for '" + filename_ + "'.");
+	}
+
+	~gzip_stream()
+	{
+		inflateEnd(&z_);
+	}
+
+	size_t read(char* out, size_t size) override
+	{
+		size_t produced = 0;
+		while (produced == 0 && !finished_) {
+			// avail_in and avail_out are 32 bit, the input is fed in pieces
+			if (z_.avail_in == 0) {
+				z_.avail_in = static_cast<uInt>(std::min<size_t>(last_ - next_, std::numeric_limits<uInt>::max()));
+				z_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(next_));
+				next_ += z_.avail_in;
+			}
+			z_.avail_out = static_cast<uInt>(std::min<size_t>(size, std::numeric_limits<uInt>::max()));
+			z_.next_out = reinterpret_cast<Bytef*>(out);
+			const int result = inflate(&z_, Z_NO_FLUSH);
+			produced = reinterpret_cast<char*>(z_.next_out) - out;
+			if (result == Z_STREAM_END) {
+				if (z_.avail_in == 0 && next_ == last_)
+					finished_ = true;
+				else
+					inflateReset(&z_); // next member
+			} else if (result == Z_BUF_ERROR && z_.avail_in == 0 && next_ == last_) {
+				throw parser_error("noma::typa::gzip_stream::read(): error: '" + filename_ + "' is truncated.");
+			} else if (result != Z_OK && result != Z_BUF_ERROR) {
+				throw parser_error("noma::typa::gzip_stream::read(): error: '" + filename_ + "' is corrupt: " + (z_.msg ? z_.msg : "unknown zlib error") + ".");
+			}
+		}
+		return produced;
+	}
+
+private:
+	std::string filename_;
+	const char* next_;
+	const char* last_;
+	z_stream z_ {};
+	bool finished_ = false;
+};
+#endif
+
+#ifdef NOMA_TYPA_ZSTD
+// also handles files of several concatenated frames, like zstd -d
+class zstd_stream : public detail::decompression_stream
+{
+public:
+	zstd_stream(const std::string& filename, const char* first, const char* last) : filename_(filename), stream_(ZSTD_createDStream()), in_ { first, static_cast<size_t>(last - first), 0 }
+	{
+		if (!stream_ || ZSTD_isError(ZSTD_initDStream(stream_)))
+			throw parser_error("noma::typa::zstd_stream::zstd_stream(): error: could not initialise zstd for '" + filename_ + "'.");
+	}
+
+	~zstd_stream()
+	{
+		ZSTD_freeDStream(stream_);
+	}
+
+	size_t read(char* out, size_t size) override
+	{
+		ZSTD_outBuffer buffer { out, size, 0 };
+		while (buffer.pos == 0 && !(in_.pos == in_.size && frame_complete_)) {
+			// with all input consumed, zstd may still hold decoded data of an incomplete frame, the
+			// data is only truncated if no progress is made
+			const size_t in_pos = in_.pos;
+			const size_t result = ZSTD_decompressStream(stream_, &buffer, &in_);
+			if (ZSTD_isError(result))
+				throw parser_error("noma::typa::zstd_stream::read(): error: '" + filename_ + "' is corrupt: " + ZSTD_getErrorName(result) + ".");
+			frame_complete_ = (result == 0);
+			if (!frame_complete_ && buffer.pos == 0 && in_.pos == in_pos)
+				throw parser_error("noma::typa::zstd_stream::read(): error: '" + filename_ + "' is truncated.");
+		}
+		return buffer.pos;
+	}
+
+private:
+	std::string filename_;
+	ZSTD_DStream* stream_;
+	ZSTD_inBuffer in_;
+	bool frame_complete_ = true;
+};
+#endif
+
+std::unique_ptr<detail::decompression_stream> make_stream(const std::string& filename, compression format, const char* first, const char* last)
+{
+	switch (format) {
+#ifdef NOMA_TYPA_GZIP
+	case compression::gzip:
+		return std::unique_ptr<detail::decompression_stream>(new gzip_stream(filename, first, last));
+#endif
+#ifdef NOMA_TYPA_ZSTD
+	case compression::zstd:
+		return std::unique_ptr<detail::decompression_stream>(new zstd_stream(filename, first, last));
+#endif
+	default:
+		break;
+	}
+	static_cast<void>(first); // unused without any format
+	static_cast<void>(last);
+	const std::string option { (format == compression::gzip) ? "NOMA_TYPA_GZIP" : "NOMA_TYPA_ZSTD" };
+	throw parser_error("noma::typa::decompressor::decompressor(): error: '" + filename + "' is compressed, but support for its format was not compiled in, see the CMake option " + option + ".");
+}
+
+} // namespace
+
+// see header for explanation
+compression detect_compression(const char* first, const char* last)
+{
+	const size_t size = last - first;
+	if (size >= 2 && std::memcmp(first, "\x1f\x8b", 2) == 0)
+		return compression::gzip;
+	if (size >= 4 && std::memcmp(first, "\x28\xb5\x2f\xfd", 4) == 0)
+		return compression::zstd;
+	return compression::none;
+}
+
+decompressor::decompressor(const std::string& filename, compression format, const char* first, const char* last)
+	: stream_(make_stream(filename, format, first, last)), windows_(window_count, std::vector<char>(window_size)), sizes_(window_count, 0), current_(window_count)
+{
+	for (size_t w = 0; w < window_count; ++w)
+		free_.push_back(w);
+	thread_ = std::thread(&decompressor::run, this);
+}
+
+decompressor::~decompressor()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	changed_.notify_all();
+	thread_.join();
+}
+
+bool decompressor::next(const char*& first, const char*& last)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (current_ != window_count) {
+		free_.push_back(current_);
+		current_ = window_count;
+		changed_.notify_all();
+	}
+	changed_.wait(lock, [&]() { return !full_.empty() || done_; });
+	if (full_.empty()) {
+		if (error_)
+			std::rethrow_exception(error_);
+		return false;
+	}
+	current_ = full_.front();
+	full_.pop_front();
+	first = windows_[current_].data();
+	last = first + sizes_[current_];
+	return true;
+}
+
+// fills free windows until the end of the data, the tail after the last whitespace of a window is
+// carried over to the beginning of the next one
+void decompressor::run()
+{
+	try {
+		std::vector<char> carry;
+		bool end = false;
+		while (!end) {
+			size_t w;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				changed_.wait(lock, [&]() { return !free_.empty() || stop_; });
+				if (stop_)
+					return;
+				w = free_.front();
+				free_.pop_front();
+			}
+
+			NOMA_TYPA_STATS_PHASE(file_io, 0);
+			std::vector<char>& window = windows_[w];
+			if (window.size() <= carry.size())
+				window.resize(2 * carry.size());
+			std::copy(carry.begin(), carry.end(), window.begin());
+			const size_t carried = carry.size();
+			size_t used = carried;
+			size_t cut;
+			while (true) {
+				const size_t produced = stream_->read(window.data() + used, window.size() - used);
+				used += produced;
+				end = (produced == 0);
+				if (end) {
+					cut = used;
+					break;
+				}
+				if (used < window.size())
+					continue;
+				cut = used;
+				while (cut > 0 && !is_space(window[cut - 1]))
+					--cut;
+				if (cut > 0)
+					break;
+				window.resize(2 * window.size()); // a single token fills the window
+			}
+			carry.assign(window.begin() + cut, window.begin() + used);
+			NOMA_TYPA_STATS_PHASE_BYTES(used - carried);
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (cut > 0) {
+				sizes_[w] = cut;
+				full_.push_back(w);
+			} else {
+				free_.push_back(w);
+			}
+			done_ = end;
+			changed_.notify_all();
+		}
+	} catch (...) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		error_ = std::current_exception();
+		done_ = true;
+		changed_.notify_all();
+	}
+}
+
+const size_t decompressor::window_size;
+const size_t decompressor::window_count;
+
+} // namespace typa
+} // namespace noma
@@ -0,0 +1,479 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include "noma/typa/format.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace noma {
+namespace typa {
+
+namespace {
+
+/**
+ * Grisu2, following the structure of Loitsch's reference implementation: the value and its rounding
+ * boundaries are scaled by a cached power of ten into a fixed point range, in which the digits are
+ * generated with 64 bit integer arithmetic.
+ */
+
+// floating point number f * 2^e with a 64 bit significand ("do it yourself floating point")
+struct diy_fp
+{
+	uint64_t f;
+	int e;
+
+	diy_fp(uint64_t f, int e) : f(f), e(e) { }
+};
+
+// x - y, for x.e == y.e and x.f >= y.f
+inline diy_fp subtract(const diy_fp& x, const diy_fp& y)
+{
+	return diy_fp(x.f - y.f, x.e);
+}
+
+// upper 64 bits of x.f * y.f, rounded half up
+inline diy_fp multiply(const diy_fp& x, const diy_fp& y)
+{
+#ifdef __SIZEOF_INT128__
+	const unsigned __int128 p = static_cast<unsigned __int128>(x.f) * y.f;
+	const uint64_t h = static_cast<uint64_t>(p >> 64) + (static_cast<uint64_t>(p >> 63) & 1);
+#else
+	const uint64_t x_lo = x.f & 0xFFFFFFFFu, x_hi = x.f >> 32;
+	const uint64_t y_lo = y.f & 0xFFFFFFFFu, y_hi = y.f >> 32;
+	const uint64_t p0 = x_lo * y_lo, p1 = x_lo * y_hi, p2 = x_hi * y_lo, p3 = x_hi * y_hi;
+	const uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu) + (uint64_t(1) << 31);
+	const uint64_t h = p3 + (p2 >> 32) + (p1 >> 32) + (q >> 32);
+#endif
+	return diy_fp(h, x.e + y.e + 64);
+}
+
+inline diy_fp normalize(diy_fp x)
+{
+	assert(x.f != 0);
+	while ((x.f >> 63) == 0) {
+		x.f <<= 1;
+		--x.e;
+	}
+	return x;
+}
+
+// shift x to the exponent 'e' <= x.e, without losing bits
+inline diy_fp normalize_to(const diy_fp& x, int e)
+{
+	assert(x.e - e >= 0 && ((x.f << (x.e - e)) >> (x.e - e)) == x.f);
+	return diy_fp(x.f << (x.e - e), e);
+}
+
+/**
+ * The value and the boundaries m_minus and m_plus of its rounding interval, i.e. every number in
+ * (m_minus, m_plus) rounds to it. All three share the exponent of the normalised m_plus.
+ */
+struct boundaries
+{
+	diy_fp w;
+	diy_fp minus;
+	diy_fp plus;
+};
+
+// for positive, finite values
+template<typename Float>
+boundaries compute_boundaries(Float value)
+{
+	static_assert(std::numeric_limits<Float>::is_iec559, "noma::typa::format_real() requires IEEE 754 floating point");
+	typedef typename std::conditional<sizeof(Float) == 4, uint32_t, uint64_t>::type bits_type;
+	const int digits = std::numeric_limits<Float>::digits; // including the hidden bit
+	const int bias = std::numeric_limits<Float>::max_exponent - 1 + (digits - 1);
+	const uint64_t hidden_bit = uint64_t(1) << (digits - 1);
+
+	bits_type bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	const uint64_t biased_exponent = bits >> (digits - 1);
+	const uint64_t fraction = bits & (hidden_bit - 1);
+
+	const diy_fp v = (biased_exponent == 0) ? diy_fp(fraction, 1 - bias) // subnormal
+	                                        : diy_fp(fraction + hidden_bit, static_cast<int>(biased_exponent) - bias);
+	// the lower boundary is closer for powers of two, as the exponent changes below them
+	const bool lower_boundary_is_closer = fraction == 0 && biased_exponent > 1;
+	const diy_fp m_plus(2 * v.f + 1, v.e - 1);
+	const diy_fp m_minus = lower_boundary_is_closer ? diy_fp(4 * v.f - 1, v.e - 2) : diy_fp(2 * v.f - 1, v.e - 1);
+
+	const diy_fp plus = normalize(m_plus);
+	return { normalize(v), normalize_to(m_minus, plus.e), plus };
+}
+
+// the scaled significands have exponents in [alpha, gamma], so that the integral part fits 32 bits
+const int alpha = -60;
+const int gamma = -32;
+
+// 10^k ~= f * 2^e
+struct cached_power
+{
+	uint64_t f;
+	int e;
+	int k;
+};
+
+const int cached_powers_min_k = -300;
+const int cached_powers_k_step = 8;
+
+const cached_power cached_powers[] = {
+	{ 0xAB70FE17C79AC6CA, -1060, -300 },
+	{ 0xFF77B1FCBEBCDC4F, -1034, -292 },
+	{ 0xBE5691EF416BD60C, -1007, -284 },
+	{ 0x8DD01FAD907FFC3C,  -980, -276 },
+	{ 0xD3515C2831559A83,  -954, -268 },
+	{ 0x9D71AC8FADA6C9B5,  -927, -260 },
+	{ 0xEA9C227723EE8BCB,  -901, -252 },
+	{ 0xAECC49914078536D,  -874, -244 },
+	{ 0x823C12795DB6CE57,  -847, -236 },
+	{ 0xC21094364DFB5637,  -821, -228 },
+	{ 0x9096EA6F3848984F,  -794, -220 },
+	{ 0xD77485CB25823AC7,  -768, -212 },
+	{ 0xA086CFCD97BF97F4,  -741, -204 },
+	{ 0xEF340A98172AACE5,  -715, -196 },
+	{ 0xB23867FB2A35B28E,  -688, -188 },
+	{ 0x84C8D4DFD2C63F3B,  -661, -180 },
+	{ 0xC5DD44271AD3CDBA,  -635, -172 },
+	{ 0x936B9FCEBB25C996,  -608, -164 },
+	{ 0xDBAC6C247D62A584,  -582, -156 },
+	{ 0xA3AB66580D5FDAF6,  -555, -148 },
+	{ 0xF3E2F893DEC3F126,  -529, -140 },
+	{ 0xB5B5ADA8AAFF80B8,  -502, -132 },
+	{ 0x87625F056C7C4A8B,  -475, -124 },
+	{ 0xC9BCFF6034C13053,  -449, -116 },
+	{ 0x964E858C91BA2655,  -422, -108 },
+	{ 0xDFF9772470297EBD,  -396, -100 },
+	{ 0xA6DFBD9FB8E5B88F,  -369,  -92 },
+	{ 0xF8A95FCF88747D94,  -343,  -84 },
+	{ 0xB94470938FA89BCF,  -316,  -76 },
+	{ 0x8A08F0F8BF0F156B,  -289,  -68 },
+	{ 0xCDB02555653131B6,  -263,  -60 },
+	{ 0x993FE2C6D07B7FAC,  -236,  -52 },
+	{ 0xE45C10C42A2B3B06,  -210,  -44 },
+	{ 0xAA242499697392D3,  -183,  -36 },
+	{ 0xFD87B5F28300CA0E,  -157,  -28 },
+	{ 0xBCE5086492111AEB,  -130,  -20 },
+	{ 0x8CBCCC096F5088CC,  -103,  -12 },
+	{ 0xD1B71758E219652C,   -77,   -4 },
+	{ 0x9C40000000000000,   -50,    4 },
+	{ 0xE8D4A51000000000,   -24,   12 },
+	{ 0xAD78EBC5AC620000,     3,   20 },
+	{ 0x813F3978F8940984,    30,   28 },
+	{ 0xC097CE7BC90715B3,    56,   36 },
+	{ 0x8F7E32CE7BEA5C70,    83,   44 },
+	{ 0xD5D238A4ABE98068,   109,   52 },
+	{ 0x9F4F2726179A2245,   136,   60 },
+	{ 0xED63A231D4C4FB27,   162,   68 },
+	{ 0xB0DE65388CC8ADA8,   189,   76 },
+	{ 0x83C7088E1AAB65DB,   216,   84 },
+	{ 0xC45D1DF942711D9A,   242,   92 },
+	{ 0x924D692CA61BE758,   269,  100 },
+	{ 0xDA01EE641A708DEA,   295,  108 },
+	{ 0xA26DA3999AEF774A,   322,  116 },
+	{ 0xF209787BB47D6B85,   348,  124 },
+	{ 0xB454E4A179DD1877,   375,  132 },
+	{ 0x865B86925B9BC5C2,   402,  140 },
+	{ 0xC83553C5C8965D3D,   428,  148 },
+	{ 0x952AB45CFA97A0B3,   455,  156 },
+	{ 0xDE469FBD99A05FE3,   481,  164 },
+	{ 0xA59BC234DB398C25,   508,  172 },
+	{ 0xF6C69A72A3989F5C,   534,  180 },
+	{ 0xB7DCBF5354E9BECE,   561,  188 },
+	{ 0x88FCF317F22241E2,   588,  196 },
+	{ 0xCC20CE9BD35C78A5,   614,  204 },
+	{ 0x98165AF37B2153DF,   641,  212 },
+	{ 0xE2A0B5DC971F303A,   667,  220 },
+	{ 0xA8D9D1535CE3B396,   694,  228 },
+	{ 0xFB9B7CD9A4A7443C,   720,  236 },
+	{ 0xBB764C4CA7A44410,   747,  244 },
+	{ 0x8BAB8EEFB6409C1A,   774,  252 },
+	{ 0xD01FEF10A657842C,   800,  260 },
+	{ 0x9B10A4E5E9913129,   827,  268 },
+	{ 0xE7109BFBA19C0C9D,   853,  276 },
+	{ 0xAC2820D9623BF429,   880,  284 },
+	{ 0x80444B5E7AA7CF85,   907,  292 },
+	{ 0xBF21E44003ACDD2D,   933,  300 },
+	{ 0x8E679C2F5E44FF8F,   960,  308 },
+	{ 0xD433179D9C8CB841,   986,  316 },
+	{ 0x9E19DB92B4E31BA9,  1013,  324 },
+};
+
+// a power of ten c = 10^-k, such that alpha <= e + c.e + 64 <= gamma
+const cached_power& get_cached_power(int e)
+{
+	// k = ceil((alpha - e - 1) * log10(2)), 78913 / 2^18 approximates log10(2)
+	const int f = alpha - e - 1;
+	const int k = (f * 78913) / (1 << 18) + (f > 0);
+	const int index = (-cached_powers_min_k + k + (cached_powers_k_step - 1)) / cached_powers_k_step;
+	assert(index >= 0 && static_cast<size_t>(index) < sizeof(cached_powers) / sizeof(cached_powers[0]));
+	const cached_power& cached = cached_powers[index];
+	assert(alpha <= cached.e + e + 64 && cached.e + e + 64 <= gamma);
+	return cached;
+}
+
+// number of decimal digits of n, and the largest power of ten <= n
+inline int find_largest_pow10(uint32_t n, uint32_t& pow10)
+{
+	static const uint32_t powers[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+	int digits = 10;
+	while (digits > 1 && n < powers[digits - 1])
+		--digits;
+	pow10 = powers[digits - 1];
+	return digits;
+}
+
+/**
+ * Move the last digit towards w, the value, as long as the result stays within the rounding interval.
+ * 'dist' is the distance of the upper boundary to w, 'delta' the width of the interval, 'rest' the
+ * distance of the upper boundary to the current digits and 'ten_k' the weight of the last digit.
+ */
+inline void round_towards_w(char* buffer, int length, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k)
+{
+	while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+		--buffer[length - 1];
+		rest += ten_k;
+	}
+}
+
+/**
+ * Generate the shortest digits for a number in (M_minus, M_plus), as close to w as possible.
+ * The value is buffer[0, length) * 10^decimal_exponent afterwards.
+ */
+void generate_digits(char* buffer, int& length, int& decimal_exponent, const diy_fp& M_minus, const diy_fp& w, const diy_fp& M_plus)
+{
+	uint64_t delta = subtract(M_plus, M_minus).f;
+	uint64_t dist = subtract(M_plus, w).f;
+
+	// split M_plus into an integral part p1 and a fractional part p2, with 'one' = 2^-e
+	const diy_fp one(uint64_t(1) << -M_plus.e, M_plus.e);
+	uint32_t p1 = static_cast<uint32_t>(M_plus.f >> -one.e);
+	uint64_t p2 = M_plus.f & (one.f - 1);
+
+	// digits of the integral part
+	uint32_t pow10;
+	int n = find_largest_pow10(p1, pow10);
+	while (n > 0) {
+		buffer[length++] = static_cast<char>('0' + p1 / pow10);
+		p1 %= pow10;
+		--n;
+		const uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+		if (rest <= delta) { // enough digits
+			decimal_exponent += n;
+			round_towards_w(buffer, length, dist, delta, rest, static_cast<uint64_t>(pow10) << -one.e);
+			return;
+		}
+		pow10 /= 10;
+	}
+
+	// digits of the fractional part, delta and dist are scaled along
+	int m = 0;
+	while (true) {
+		p2 *= 10;
+		buffer[length++] = static_cast<char>('0' + (p2 >> -one.e));
+		p2 &= one.f - 1;
+		++m;
+		delta *= 10;
+		dist *= 10;
+		if (p2 <= delta)
+			break;
+	}
+	decimal_exponent -= m;
+	round_towards_w(buffer, length, dist, delta, p2, one.f);
+}
+
+/**
+ * Shortest digits of a positive, finite 'value', see generate_digits().
+ */
+template<typename Float>
+void grisu2(Float value, char* buffer, int& length, int& decimal_exponent)
+{
+	const boundaries b = compute_boundaries(value);
+	const cached_power& cached = get_cached_power(b.plus.e);
+	const diy_fp c_minus_k(cached.f, cached.e);
+
+	const diy_fp w = multiply(b.w, c_minus_k);
+	const diy_fp w_minus = multiply(b.minus, c_minus_k);
+	const diy_fp w_plus = multiply(b.plus, c_minus_k);
+
+	// the products are off by at most one ulp, shrink the interval to stay on the safe side
+	const diy_fp M_minus(w_minus.f + 1, w_minus.e);
+	const diy_fp M_plus(w_plus.f - 1, w_plus.e);
+
+	length = 0;
+	decimal_exponent = -cached.k;
+	generate_digits(buffer, length, decimal_exponent, M_minus, w, M_plus);
+}
+
+inline int decimal_length(int value)
+{
+	int length = 1;
+	for (; value >= 10; value /= 10)
+		++length;
+	return length;
+}
+
+/**
+ * Write the value buffer[0, length) * 10^decimal_exponent in fixed or scientific notation, whichever
+ * is shorter (fixed for equal lengths).
+ */
+char* format_digits(const char* digits, int length, int decimal_exponent, char* out)
+{
+	const int point = length + decimal_exponent; // value = 0.digits * 10^point
+	const int exponent = point - 1; // value = d.igits * 10^exponent
+
+	int fixed_length;
+	if (point >= length)
+		fixed_length = point; // digits followed by zeros
+	else if (point > 0)
+		fixed_length = length + 1; // point inside the digits
+	else
+		fixed_length = 2 - point + length; // "0." followed by zeros and digits
+	const int scientific_length = length + (length > 1 ? 1 : 0) + 1 + (exponent < 0 ? 1 : 0) + decimal_length(exponent < 0 ? -exponent : exponent);
+
+	if (fixed_length <= scientific_length) {
+		if (point >= length) {
+			std::memcpy(out, digits, length);
+			std::memset(out + length, '0', point - length);
+			return out + point;
+		}
+		if (point > 0) {
+			std::memcpy(out, digits, point);
+			out[point] = '.';
+			std::memcpy(out + point + 1, digits + point, length - point);
+			return out + length + 1;
+		}
+		*out++ = '0';
+		*out++ = '.';
+		std::memset(out, '0', -point);
+		std::memcpy(out - point, digits, length);
+		return out - point + length;
+	}
+
+	*out++ = digits[0];
+	if (length > 1) {
+		*out++ = '.';
+		std::memcpy(out, digits + 1, length - 1);
+		out += length - 1;
+	}
+	*out++ = 'e';
+	if (exponent < 0)
+		*out++ = '-';
+	return format_integer(static_cast<uint64_t>(exponent < 0 ? -exponent : exponent), out);
+}
+
+template<typename Float>
+char* format_real_impl(Float value, char* out)
+{
+	if (std::isnan(value)) {
+		std::memcpy(out, "nan", 3);
+		return out + 3;
+	}
+	if (std::signbit(value)) {
+		*out++ = '-';
+		value = -value;
+	}
+	if (std::isinf(value)) {
+		std::memcpy(out, "inf", 3);
+		return out + 3;
+	}
+	if (value == 0) {
+		*out = '0';
+		return out + 1;
+	}
+
+	char digits[max_number_chars];
+	int length;
+	int decimal_exponent;
+	grisu2(value, digits, length, decimal_exponent);
+	return format_digits(digits, length, decimal_exponent, out);
+}
+
+template<typename Float>
+void append_real_with_precision(std::string& data, Float value, real_notation notation, int precision)
+{
+	const char* format = (notation == real_notation::scientific) ? "%.*e" : "%.*f";
+	const int length = std::snprintf(nullptr, 0, format, precision, static_cast<double>(value));
+	const size_t size = data.size();
+	data.resize(size + length + 1);
+	std::snprintf(&data[size], length + 1, format, precision, static_cast<double>(value));
+	data.resize(size + length);
+}
+
+} // namespace
+
+// see header for explanation
+char* format_real(double value, char* out)
+{
+	return format_real_impl(value, out);
+}
+
+// see header for explanation
+char* format_real(float value, char* out)
+{
+	return format_real_impl(value, out);
+}
+
+// see header for explanation
+char* format_integer(uint64_t value, char* out)
+{
+	static const char digit_pairs[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+	char buffer[max_number_chars];
+	char* it = buffer + max_number_chars;
+	while (value >= 100) {
+		const size_t pair = static_cast<size_t>(value % 100) * 2;
+		value /= 100;
+		*--it = digit_pairs[pair + 1];
+		*--it = digit_pairs[pair];
+	}
+	if (value >= 10) {
+		const size_t pair = static_cast<size_t>(value) * 2;
+		*--it = digit_pairs[pair + 1];
+		*--it = digit_pairs[pair];
+	} else {
+		*--it = static_cast<char>('0' + value);
+	}
+	const size_t length = buffer + max_number_chars - it;
+	std::memcpy(out, it, length);
+	return out + length;
+}
+
+// see header for explanation
+char* format_integer(int64_t value, char* out)
+{
+	if (value < 0) {
+		*out++ = '-';
+		return format_integer(uint64_t(0) - static_cast<uint64_t>(value), out);
+	}
+	return format_integer(static_cast<uint64_t>(value), out);
+}
+
+void format_buffer::append_real(double value)
+{
+	if (notation_ != real_notation::shortest) {
+		append_real_with_precision(data_, value, notation_, precision_);
+		return;
+	}
+	char digits[max_number_chars];
+	append(digits, format_real(value, digits) - digits);
+}
+
+void format_buffer::append_real(float value)
+{
+	if (notation_ != real_notation::shortest) {
+		append_real_with_precision(data_, value, notation_, precision_);
+		return;
+	}
+	char digits[max_number_chars];
+	append(digits, format_real(value, digits) - digits);
+}
+
+} // namespace typa
+} // namespace noma
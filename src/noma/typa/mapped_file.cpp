@@ -0,0 +1,70 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include "noma/typa/mapped_file.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define NOMA_TYPA_MMAP
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "noma/typa/parser_error.hpp"
+#include "noma/typa/stats.hpp"
+
+namespace noma {
+namespace typa {
+
+mapped_file::mapped_file(const std::string& filename)
+{
+	NOMA_TYPA_STATS_PHASE(file_io, 0); // excludes page faults while reading a mapped file
+#ifdef NOMA_TYPA_MMAP
+	const int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw parser_error("noma::typa::mapped_file::mapped_file(): error: could not open file '" + filename + "'.");
+	struct stat info;
+	if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+		size_ = static_cast<size_t>(info.st_size);
+		void* address = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (address != MAP_FAILED) {
+			data_ = static_cast<const char*>(address);
+			mapped_ = true;
+		}
+	}
+	::close(fd);
+#endif
+	if (!mapped_) {
+		// fallback: read the whole file
+		std::ifstream fs(filename, std::ios::binary);
+		if (fs.fail())
+			throw parser_error("noma::typa::mapped_file::mapped_file(): error: could not open file '" + filename + "'.");
+		std::vector<char> buffer { std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>() };
+		size_ = buffer.size();
+		char* data = new char[size_ + 1];
+		std::memcpy(data, buffer.data(), size_);
+		data_ = data;
+	}
+	NOMA_TYPA_STATS_PHASE_BYTES(size_);
+}
+
+mapped_file::~mapped_file()
+{
+#ifdef NOMA_TYPA_MMAP
+	if (mapped_) {
+		::munmap(const_cast<char*>(data_), size_);
+		return;
+	}
+#endif
+	delete [] data_;
+}
+
+} // namespace typa
+} // namespace noma
@@ -0,0 +1,117 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include "noma/typa/matrix_market.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace noma {
+namespace typa {
+
+namespace {
+
+// the banner is case-insensitive
+std::string to_lower(std::string str)
+{
+	std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return str;
+}
+
+const char* line_end(const char* first, const char* last)
+{
+	return std::find(first, last, '\n');
+}
+
+} // namespace
+
+// see header for explanation
+bool is_mtx_filename(const std::string& filename)
+{
+	const std::string extension { ".mtx" };
+	return filename.size() >= extension.size() && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+matrix_market_file::matrix_market_file(const std::string& filename) : filename_(filename), file_(filename), position_(file_.begin())
+{
+	parse_header();
+}
+
+void matrix_market_file::parse_header()
+{
+	const char* first = file_.begin();
+	const char* last = file_.end();
+	const std::string error_prefix { "noma::typa::matrix_market_file::parse_header(): error: '" + filename_ + "' " };
+
+	// banner: %%MatrixMarket matrix coordinate <field> <symmetry>
+	const char* banner_last = line_end(first, last);
+	std::vector<std::string> banner;
+	for (const char* it = skip_whitespace(first, banner_last); it != banner_last; it = skip_whitespace(it, banner_last)) {
+		const char* token_last = detail::token_end(it, banner_last);
+		banner.push_back(to_lower(std::string(it, token_last)));
+		it = token_last;
+	}
+	if (banner.size() != 5 || banner[0] != "%%matrixmarket" || banner[1] != "matrix")
+		throw parser_error(error_prefix + "is not a Matrix Market file, the first line should be '%%MatrixMarket matrix coordinate <field> <symmetry>'.");
+	if (banner[2] != "coordinate")
+		throw parser_error(error_prefix + "has format '" + banner[2] + "', only 'coordinate' is supported.");
+
+	if (banner[3] == "real")
+		field_ = mtx_field::real;
+	else if (banner[3] == "integer")
+		field_ = mtx_field::integer;
+	else if (banner[3] == "complex")
+		field_ = mtx_field::complex;
+	else if (banner[3] == "pattern")
+		field_ = mtx_field::pattern;
+	else
+		throw parser_error(error_prefix + "has unknown field '" + banner[3] + "'.");
+
+	if (banner[4] == "general")
+		symmetry_ = mtx_symmetry::general;
+	else if (banner[4] == "symmetric")
+		symmetry_ = mtx_symmetry::symmetric;
+	else if (banner[4] == "skew-symmetric")
+		symmetry_ = mtx_symmetry::skew_symmetric;
+	else if (banner[4] == "hermitian")
+		symmetry_ = mtx_symmetry::hermitian;
+	else
+		throw parser_error(error_prefix + "has unknown symmetry '" + banner[4] + "'.");
+
+	// comment and empty lines, then the size line: rows cols entries
+	const char* it = banner_last;
+	while (it != last) {
+		it = skip_whitespace(it, last);
+		if (it == last || *it != '%')
+			break;
+		it = line_end(it, last);
+	}
+	const char* size_last = line_end(it, last);
+	size_t extents[3];
+	for (size_t& extent : extents) {
+		it = skip_whitespace(it, size_last);
+		const char* token_last = detail::token_end(it, size_last);
+		if (it == token_last)
+			throw parser_error(error_prefix + "has an incomplete size line " + detail::text_location(filename_, first, it) + ", should be 'rows cols entries'.");
+		try {
+			extent = parse_value<size_t>(it, token_last);
+		} catch (boost::bad_lexical_cast&) {
+			throw parser_error(error_prefix + "has a malformed size '" + std::string(it, token_last) + "' " + detail::text_location(filename_, first, it) + ".");
+		}
+		it = token_last;
+	}
+	rows_ = extents[0];
+	cols_ = extents[1];
+	entries_ = extents[2];
+	position_ = size_last;
+
+	// every token takes at least one character and one separator, so the declared number of entries
+	// is checked before anything is allocated for them
+	const size_t max_tokens = (last - position_ + 1) / 2;
+	if (entries_ > max_tokens / tokens_per_entry())
+		throw parser_error(error_prefix + "declares " + std::to_string(entries_) + " entries, but has room for at most " + std::to_string(max_tokens / tokens_per_entry()) + ".");
+}
+
+} // namespace typa
+} // namespace noma
@@ -0,0 +1,197 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include "noma/typa/npy.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "noma/typa/stats.hpp"
+#include "noma/typa/util.hpp"
+
+namespace noma {
+namespace typa {
+
+namespace {
+
+const char npy_magic[] = "\x93NUMPY";
+const size_t npy_magic_size = 6;
+const size_t npy_header_alignment = 64;
+
+/**
+ * Find the value of 'key' in the header dictionary, e.g. "'shape': (3, 4), ..." and return a pointer
+ * to its first character, or nullptr.
+ */
+const char* find_value(const std::string& header, const std::string& key)
+{
+	for (const char quote : { '\'', '"' }) {
+		const size_t pos = header.find(quote + key + quote);
+		if (pos == std::string::npos)
+			continue;
+		const char* it = header.c_str() + pos + key.size() + 2;
+		while (is_space(*it))
+			++it;
+		if (*it != ':')
+			return nullptr;
+		++it;
+		while (is_space(*it))
+			++it;
+		return it;
+	}
+	return nullptr;
+}
+
+uint32_t read_little_endian(const char* data, size_t bytes)
+{
+	uint32_t value = 0;
+	for (size_t i = 0; i < bytes; ++i)
+		value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+	return value;
+}
+
+} // namespace
+
+// see header for explanation
+char npy_byte_order()
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	return '>';
+#else
+	return '<';
+#endif
+}
+
+// see header for explanation
+bool is_npy_filename(const std::string& filename)
+{
+	const std::string extension { ".npy" };
+	return filename.size() >= extension.size() && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+npy_file::npy_file(const std::string& filename) : filename_(filename), file_(filename), data_(file_.data()), size_(file_.size())
+{
+	parse_header();
+}
+
+void npy_file::parse_header()
+{
+	const std::string& filename = filename_;
+	const std::string error_prefix { "noma::typa::npy_file::npy_file(): error: " };
+
+	// magic string, version, header length, header
+	if (size_ < npy_magic_size + 4 || std::memcmp(data_, npy_magic, npy_magic_size) != 0)
+		throw parser_error(error_prefix + "'" + filename + "' is not a .npy file.");
+	const int major_version = data_[npy_magic_size];
+	if (major_version < 1 || major_version > 3)
+		throw parser_error(error_prefix + "'" + filename + "' has unsupported .npy version " + std::to_string(major_version) + ".");
+	const size_t length_size = (major_version == 1) ? 2 : 4;
+	const size_t header_offset = npy_magic_size + 2 + length_size;
+	if (size_ < header_offset)
+		throw parser_error(error_prefix + "'" + filename + "' has a truncated header.");
+	const size_t header_size = read_little_endian(data_ + npy_magic_size + 2, length_size);
+	payload_offset_ = header_offset + header_size;
+	if (size_ < payload_offset_)
+		throw parser_error(error_prefix + "'" + filename + "' has a truncated header.");
+	const std::string header { data_ + header_offset, header_size };
+
+	// header: Python dictionary literal, e.g. {'descr': '<f8', 'fortran_order': False, 'shape': (3, 4), }
+	const char* descr = find_value(header, "descr");
+	const char* fortran_order = find_value(header, "fortran_order");
+	const char* shape = find_value(header, "shape");
+	if (!descr || !fortran_order || !shape || (*descr != '\'' && *descr != '"') || *shape != '(')
+		throw parser_error(error_prefix + "'" + filename + "' has a malformed header: " + header);
+
+	const char* descr_end = std::strchr(descr + 1, *descr);
+	if (!descr_end)
+		throw parser_error(error_prefix + "'" + filename + "' has a malformed header: " + header);
+	descr_.assign(descr + 1, descr_end);
+
+	if (std::strncmp(fortran_order, "True", 4) == 0)
+		fortran_order_ = true;
+	else if (std::strncmp(fortran_order, "False", 5) != 0)
+		throw parser_error(error_prefix + "'" + filename + "' has a malformed header: " + header);
+
+	for (const char* it = shape + 1; *it != ')'; ) {
+		if (is_space(*it) || *it == ',') {
+			++it;
+		} else if (*it >= '0' && *it <= '9') {
+			char* end;
+			shape_.push_back(std::strtoull(it, &end, 10));
+			it = end;
+		} else {
+			throw parser_error(error_prefix + "'" + filename + "' has a malformed header: " + header);
+		}
+	}
+}
+
+void npy_file::check_payload(const std::string& descr, size_t element_size, size_t dimensions) const
+{
+	const std::string error_prefix { "noma::typa::npy_file::payload(): error: '" + filename_ + "' " };
+
+	// '=' is native byte order, single byte types have none ('|')
+	std::string file_descr = descr_;
+	if (!file_descr.empty() && (file_descr[0] == '=' || (element_size == 1 && (file_descr[0] == '<' || file_descr[0] == '>'))))
+		file_descr[0] = descr[0];
+	if (file_descr != descr)
+		throw parser_error(error_prefix + "has element type '" + descr_ + "', expected '" + descr + "'.");
+
+	if (shape_.size() != dimensions)
+		throw parser_error(error_prefix + "has " + std::to_string(shape_.size()) + " dimension(s), expected " + std::to_string(dimensions) + ".");
+
+	// a crafted shape must not wrap around and pass the size check, unless it has no elements at all
+	const size_t max_size = std::numeric_limits<size_t>::max();
+	const bool empty = std::find(shape_.begin(), shape_.end(), 0) != shape_.end();
+	size_t elements = 1;
+	for (size_t extent : shape_) {
+		if (!empty && elements > max_size / extent)
+			throw parser_error(error_prefix + "has a shape with too many elements.");
+		elements *= extent;
+	}
+	if (elements > max_size / element_size)
+		throw parser_error(error_prefix + "has a shape with too many elements.");
+	if (size_ - payload_offset_ < elements * element_size)
+		throw parser_error(error_prefix + "is truncated.");
+}
+
+// see header for explanation
+void write_npy(const std::string& filename, const std::string& descr, const std::vector<size_t>& shape, const void* data, size_t size, size_t row_stride)
+{
+	NOMA_TYPA_STATS_PHASE(file_io, size);
+	std::string header { "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (" };
+	for (size_t i = 0; i < shape.size(); ++i)
+		header += std::to_string(shape[i]) + ((shape.size() == 1) ? "," : (i + 1 < shape.size()) ? ", " : "");
+	header += "), }";
+
+	// pad with spaces and a final '\n', so that the payload is aligned, version 2.0 for huge headers
+	const size_t length_size = (header.size() + npy_header_alignment <= 65535) ? 2 : 4;
+	const size_t prefix_size = npy_magic_size + 2 + length_size;
+	header.append((npy_header_alignment - (prefix_size + header.size() + 1) % npy_header_alignment) % npy_header_alignment, ' ');
+	header += '\n';
+
+	std::ofstream fs(filename, std::ios::binary);
+	if (fs.fail())
+		throw parser_error("noma::typa::write_npy(): error: could not open file '" + filename + "' for writing.");
+	fs.write(npy_magic, npy_magic_size);
+	const char version[2] = { static_cast<char>((length_size == 2) ? 1 : 2), 0 };
+	fs.write(version, 2);
+	for (size_t i = 0; i < length_size; ++i)
+		fs.put(static_cast<char>((header.size() >> (8 * i)) & 0xFF));
+	fs << header;
+	const size_t rows = shape.empty() ? 0 : shape[0];
+	const size_t row_size = (rows == 0) ? 0 : size / rows;
+	if (row_stride == 0 || row_stride == row_size) {
+		fs.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+	} else {
+		for (size_t i = 0; i < rows; ++i)
+			fs.write(static_cast<const char*>(data) + i * row_stride, static_cast<std::streamsize>(row_size));
+	}
+	if (fs.fail())
+		throw parser_error("noma::typa::write_npy(): error: could not write file '" + filename + "'.");
+}
+
+} // namespace typa
+} // namespace noma
@@ -0,0 +1,31 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include "noma/typa/parallel.hpp"
+
+namespace noma {
+namespace typa {
+
+namespace {
+
+std::atomic<size_t> configured_thread_count { 1 };
+
+} // namespace
+
+// see header for explanation
+size_t thread_count()
+{
+	return configured_thread_count.load(std::memory_order_relaxed);
+}
+
+// see header for explanation
+void set_thread_count(size_t count)
+{
+	if (count == 0)
+		count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	configured_thread_count.store(count, std::memory_order_relaxed);
+}
+
+} // namespace typa
+} // namespace noma
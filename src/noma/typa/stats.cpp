@@ -0,0 +1,164 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include "noma/typa/stats.hpp"
+
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+
+namespace noma {
+namespace typa {
+
+namespace {
+
+struct atomic_phase_stats
+{
+	std::atomic<uint64_t> calls { 0 };
+	std::atomic<uint64_t> nanoseconds { 0 };
+	std::atomic<uint64_t> bytes { 0 };
+};
+
+atomic_phase_stats phase_totals[parse_phase_count];
+std::atomic<uint64_t> api_call_total { 0 };
+std::atomic<uint64_t> allocation_total { 0 };
+std::atomic<uint64_t> allocated_bytes_total { 0 };
+
+std::mutex callback_mutex;
+parse_stats_callback callback;
+std::atomic<bool> callback_set { false };
+
+thread_local size_t call_depth = 0;
+
+} // namespace
+
+// see header for explanation
+const char* parse_phase_name(parse_phase phase)
+{
+	static const char* const names[parse_phase_count] { "grammar", "validation", "extraction", "conversion", "file_io", "fill" };
+	return names[static_cast<size_t>(phase)];
+}
+
+// see header for explanation
+parse_stats& parse_stats::operator-=(const parse_stats& other)
+{
+	for (size_t i = 0; i < parse_phase_count; ++i) {
+		phases[i].calls -= other.phases[i].calls;
+		phases[i].nanoseconds -= other.phases[i].nanoseconds;
+		phases[i].bytes -= other.phases[i].bytes;
+	}
+	api_calls -= other.api_calls;
+	allocations -= other.allocations;
+	allocated_bytes -= other.allocated_bytes;
+	return *this;
+}
+
+// see header for explanation
+void parse_stats::print(std::ostream& out) const
+{
+	out << std::left << std::setw(12) << "phase" << std::right << std::setw(12) << "calls" << std::setw(16) << "time [ms]" << std::setw(16) << "bytes" << "\n";
+	for (size_t i = 0; i < parse_phase_count; ++i) {
+		out << std::left << std::setw(12) << parse_phase_name(static_cast<parse_phase>(i)) << std::right
+		    << std::setw(12) << phases[i].calls << std::setw(16) << phases[i].nanoseconds / 1e6 << std::setw(16) << phases[i].bytes << "\n";
+	}
+	out << "api calls: " << api_calls << ", allocations: " << allocations << " (" << allocated_bytes << " bytes)" << std::endl;
+}
+
+// see header for explanation
+parse_stats get_parse_stats()
+{
+	parse_stats result;
+	for (size_t i = 0; i < parse_phase_count; ++i) {
+		result.phases[i].calls = phase_totals[i].calls;
+		result.phases[i].nanoseconds = phase_totals[i].nanoseconds;
+		result.phases[i].bytes = phase_totals[i].bytes;
+	}
+	result.api_calls = api_call_total;
+	result.allocations = allocation_total;
+	result.allocated_bytes = allocated_bytes_total;
+	return result;
+}
+
+// see header for explanation
+void reset_parse_stats()
+{
+	for (auto& totals : phase_totals) {
+		totals.calls = 0;
+		totals.nanoseconds = 0;
+		totals.bytes = 0;
+	}
+	api_call_total = 0;
+	allocation_total = 0;
+	allocated_bytes_total = 0;
+}
+
+// see header for explanation
+void set_parse_stats_callback(parse_stats_callback new_callback)
+{
+	std::lock_guard<std::mutex> lock(callback_mutex);
+	callback_set = static_cast<bool>(new_callback);
+	callback = std::move(new_callback);
+}
+
+namespace detail {
+
+// see header for explanation
+void record_phase(parse_phase phase, uint64_t nanoseconds, uint64_t bytes)
+{
+	atomic_phase_stats& totals = phase_totals[static_cast<size_t>(phase)];
+	totals.calls.fetch_add(1, std::memory_order_relaxed);
+	totals.nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+	totals.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+// see header for explanation
+void record_allocation(uint64_t bytes)
+{
+	allocation_total.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes_total.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+// see header for explanation
+phase_timer*& current_phase_timer()
+{
+	thread_local phase_timer* current = nullptr;
+	return current;
+}
+
+// see header for explanation
+stats_call::stats_call(const char* name) : name_(name), outermost_(call_depth++ == 0)
+{
+	if (outermost_ && callback_set) {
+		has_callback_ = true;
+		start_ = get_parse_stats();
+	}
+}
+
+// see header for explanation
+stats_call::~stats_call()
+{
+	if (outermost_) {
+		++api_call_total;
+		if (has_callback_) {
+			parse_stats call_stats = get_parse_stats();
+			call_stats -= start_;
+			parse_stats_callback current;
+			{
+				std::lock_guard<std::mutex> lock(callback_mutex);
+				current = callback;
+			}
+			// not under the lock, so that the callback may call into the library, still inside this
+			// call, so that instrumented functions it calls do not invoke it again
+			if (current)
+				current(name_, call_stats);
+		}
+	}
+	--call_depth;
+}
+
+} // namespace detail
+
+} // namespace typa
+} // namespace noma
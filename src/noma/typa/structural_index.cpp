@@ -0,0 +1,258 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include "noma/typa/structural_index.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "noma/typa/stats.hpp"
+#include "noma/typa/util.hpp"
+
+// run time dispatch between the x86 SIMD implementations needs the GCC/Clang target attribute
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	#define NOMA_TYPA_X86_DISPATCH
+	#include <immintrin.h>
+#endif
+
+namespace noma {
+namespace typa {
+
+namespace {
+
+inline bool is_structural(char c)
+{
+	return c == '{' || c == '}' || c == '(' || c == ')' || c == ',';
+}
+
+void find_structurals_scalar(const char* first, const char* last, std::vector<const char*>& positions)
+{
+	for (const char* it = first; it != last; ++it)
+		if (is_structural(*it))
+			positions.push_back(it);
+}
+
+char* copy_without_whitespace_scalar(const char* first, const char* last, char* out)
+{
+	for (const char* it = first; it != last; ++it)
+		if (!is_space(*it))
+			*out++ = *it;
+	return out;
+}
+
+/**
+ * Append 'base + i' for every bit i set in 'mask'.
+ */
+inline void append_positions(const char* base, uint64_t mask, std::vector<const char*>& positions)
+{
+	while (mask) {
+		positions.push_back(base + __builtin_ctzll(mask));
+		mask &= mask - 1;
+	}
+}
+
+#ifdef NOMA_TYPA_X86_DISPATCH
+
+/**
+ * Shuffle indices packing the bytes selected by an 8 bit mask to the front, for PSHUFB.
+ */
+struct compress_table
+{
+	uint8_t indices[256][8];
+
+	compress_table()
+	{
+		for (size_t mask = 0; mask < 256; ++mask) {
+			size_t k = 0;
+			for (uint8_t i = 0; i < 8; ++i)
+				if (mask & (1u << i))
+					indices[mask][k++] = i;
+			for (; k < 8; ++k)
+				indices[mask][k] = 0x80; // zero
+		}
+	}
+};
+
+const compress_table& get_compress_table()
+{
+	static const compress_table value;
+	return value;
+}
+
+/**
+ * Write the bytes of 'chunk' selected by the 16 bit mask 'keep' to 'out', packed.
+ * NOTE: Always stores 16 bytes, but never beyond the input position of 'chunk' when used in place.
+ */
+__attribute__((target("sse4.2")))
+inline char* compress16(__m128i chunk, uint32_t keep, char* out, const compress_table& table)
+{
+	const uint32_t keep_lo = keep & 0xFFu;
+	const uint32_t keep_hi = keep >> 8;
+	const __m128i shuffle_lo = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(table.indices[keep_lo]));
+	const __m128i shuffle_hi = _mm_add_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(table.indices[keep_hi])), _mm_set1_epi8(8));
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(chunk, shuffle_lo));
+	out += __builtin_popcount(keep_lo);
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(chunk, shuffle_hi));
+	return out + __builtin_popcount(keep_hi);
+}
+
+// AVX2: 64 bytes per iteration, classified with byte compares
+
+__attribute__((target("avx2")))
+inline uint32_t structural_mask_avx2(__m256i chunk)
+{
+	const __m256i hits = _mm256_or_si256(
+		_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('}'))),
+		_mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('(')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(')'))),
+			_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(','))));
+	return static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+}
+
+__attribute__((target("avx2")))
+inline uint32_t whitespace_mask_avx2(__m256i chunk)
+{
+	// ' ' or '\t' <= c <= '\r', the latter as an unsigned range check: (c - '\t') <= 4
+	const __m256i offset = _mm256_sub_epi8(chunk, _mm256_set1_epi8('\t'));
+	const __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(4)), offset);
+	const __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), in_range);
+	return static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+}
+
+__attribute__((target("avx2")))
+void find_structurals_avx2(const char* first, const char* last, std::vector<const char*>& positions)
+{
+	const char* it = first;
+	for (; last - it >= 64; it += 64) {
+		const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+		const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it + 32));
+		const uint64_t mask = structural_mask_avx2(lo) | (static_cast<uint64_t>(structural_mask_avx2(hi)) << 32);
+		append_positions(it, mask, positions);
+	}
+	find_structurals_scalar(it, last, positions);
+}
+
+__attribute__((target("avx2")))
+char* copy_without_whitespace_avx2(const char* first, const char* last, char* out)
+{
+	const compress_table& table = get_compress_table();
+	const char* it = first;
+	for (; last - it >= 32; it += 32) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+		const uint32_t mask = whitespace_mask_avx2(chunk);
+		if (mask == 0) { // common case: copy the whole block
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chunk);
+			out += 32;
+		} else {
+			const uint32_t keep = ~mask;
+			out = compress16(_mm256_castsi256_si128(chunk), keep & 0xFFFFu, out, table);
+			out = compress16(_mm256_extracti128_si256(chunk, 1), keep >> 16, out, table);
+		}
+	}
+	return copy_without_whitespace_scalar(it, last, out);
+}
+
+// SSE4.2: 16 bytes per iteration, classified against a character set with PCMPESTRM
+
+const int sse42_any_mask = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+
+__attribute__((target("sse4.2")))
+void find_structurals_sse42(const char* first, const char* last, std::vector<const char*>& positions)
+{
+	const __m128i set = _mm_setr_epi8('{', '}', '(', ')', ',', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	const char* it = first;
+	for (; last - it >= 16; it += 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+		const uint32_t mask = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_cmpestrm(set, 5, chunk, 16, sse42_any_mask))) & 0xFFFFu;
+		append_positions(it, mask, positions);
+	}
+	find_structurals_scalar(it, last, positions);
+}
+
+__attribute__((target("sse4.2")))
+char* copy_without_whitespace_sse42(const char* first, const char* last, char* out)
+{
+	const __m128i set = _mm_setr_epi8(' ', '\t', '\n', '\v', '\f', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	const compress_table& table = get_compress_table();
+	const char* it = first;
+	for (; last - it >= 16; it += 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+		const uint32_t mask = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_cmpestrm(set, 6, chunk, 16, sse42_any_mask))) & 0xFFFFu;
+		if (mask == 0) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), chunk);
+			out += 16;
+		} else {
+			out = compress16(chunk, ~mask & 0xFFFFu, out, table);
+		}
+	}
+	return copy_without_whitespace_scalar(it, last, out);
+}
+
+#endif // NOMA_TYPA_X86_DISPATCH
+
+std::vector<detail::structural_kernels> supported_kernels()
+{
+	std::vector<detail::structural_kernels> result;
+#ifdef NOMA_TYPA_X86_DISPATCH
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		result.push_back({ &find_structurals_avx2, &copy_without_whitespace_avx2, "avx2" });
+	if (__builtin_cpu_supports("sse4.2"))
+		result.push_back({ &find_structurals_sse42, &copy_without_whitespace_sse42, "sse4.2" });
+#endif
+	result.push_back({ &find_structurals_scalar, &copy_without_whitespace_scalar, "scalar" });
+	return result;
+}
+
+const detail::structural_kernels& selected_kernels()
+{
+	return detail::structural_index_kernels().front();
+}
+
+} // namespace
+
+namespace detail {
+
+// see header for explanation
+const std::vector<structural_kernels>& structural_index_kernels()
+{
+	static const std::vector<structural_kernels> value = supported_kernels();
+	return value;
+}
+
+} // namespace detail
+
+// see header for explanation
+void find_structurals(const char* first, const char* last, std::vector<const char*>& positions)
+{
+	selected_kernels().find_structurals(first, last, positions);
+}
+
+// see header for explanation
+char* copy_without_whitespace(const char* first, const char* last, char* out)
+{
+	return selected_kernels().copy_without_whitespace(first, last, out);
+}
+
+// see header for explanation
+const char* structural_index_implementation()
+{
+	return selected_kernels().name;
+}
+
+const size_t structural_index::window_size;
+const size_t structural_index::min_input_size;
+
+void structural_index::index_next_window()
+{
+	const char* window_end = indexed_end_ + std::min(static_cast<size_t>(last_ - indexed_end_), window_size);
+	NOMA_TYPA_STATS_PHASE(validation, window_end - indexed_end_);
+	positions_.clear();
+	cursor_ = 0;
+	find_structurals(indexed_end_, window_end, positions_);
+	indexed_end_ = window_end;
+}
+
+} // namespace typa
+} // namespace noma
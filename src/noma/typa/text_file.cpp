@@ -0,0 +1,120 @@
+// Copyright (c) 2017 Matthias Noack <ma.noack.pr@gmail.com>
+//
+// See accompanying file LICENSE and README for further information.
+
+#include "noma/typa/text_file.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace noma {
+namespace typa {
+
+namespace detail {
+
+// see header for explanation
+std::vector<text_range> split_at_whitespace(const char* first, const char* last, size_t n)
+{
+	std::vector<text_range> ranges;
+	const size_t part_size = (last - first) / std::max<size_t>(n, 1);
+	const char* part_first = first;
+	for (size_t k = 1; k < n; ++k) {
+		const char* cut = std::max(first + k * part_size, part_first);
+		cut = std::find_if(cut, last, is_space);
+		ranges.push_back({ part_first, cut });
+		part_first = cut;
+	}
+	ranges.push_back({ part_first, last });
+	return ranges;
+}
+
+// see header for explanation
+size_t count_tokens(const char* first, const char* last)
+{
+	size_t count = 0;
+	bool in_token = false;
+	for (const char* it = first; it != last; ++it) {
+		const bool space = is_space(*it);
+		count += !space && !in_token;
+		in_token = !space;
+	}
+	return count;
+}
+
+// see header for explanation
+std::string text_location(const std::string& filename, const char* first, const char* position, size_t first_line, size_t first_column)
+{
+	const char* line_first = first;
+	size_t line = first_line;
+	for (const char* it = first; it != position; ++it) {
+		if (*it == '\n') {
+			++line;
+			line_first = it + 1;
+		}
+	}
+	const size_t column = (line == first_line) ? first_column + (position - first) : position - line_first + 1;
+	return "in '" + filename + "' at line " + std::to_string(line) + ", column " + std::to_string(column);
+}
+
+} // namespace detail
+
+text_file::text_file(const std::string& filename) : filename_(filename), file_(filename), first_(file_.begin()), last_(file_.end()), position_(first_)
+{
+	const compression format = detect_compression(file_.begin(), file_.end());
+	if (format != compression::none) {
+		// empty until the first window is decompressed
+		decompressor_.reset(new decompressor(filename_, format, file_.begin(), file_.end()));
+		first_ = last_ = position_ = nullptr;
+	}
+}
+
+// see header for explanation
+std::vector<size_t> text_file::read_extents(size_t dimensions)
+{
+	std::vector<size_t> extents;
+	for (size_t i = 0; i < dimensions; ++i) {
+		const char* first = skip_whitespace(position_, last_);
+		while (first == last_ && next_window())
+			first = skip_whitespace(position_, last_);
+		const char* last = detail::token_end(first, last_);
+		if (first == last)
+			throw parser_error("noma::typa::text_file::read_extents(): error: missing extent " + location(first) + ".");
+		try {
+			extents.push_back(parse_value<size_t>(first, last));
+		} catch (boost::bad_lexical_cast&) {
+			throw parser_error("noma::typa::text_file::read_extents(): error: malformed extent '" + std::string(first, last) + "' " + location(first) + ".");
+		}
+		position_ = last;
+	}
+	return extents;
+}
+
+bool text_file::next_window()
+{
+	if (!decompressor_)
+		return false;
+	// the next window begins where the current one ends
+	const size_t lines = std::count(first_, last_, '\n');
+	if (lines > 0)
+		first_column_ = 1 + (last_ - std::find(std::reverse_iterator<const char*>(last_), std::reverse_iterator<const char*>(first_), '\n').base());
+	else
+		first_column_ += last_ - first_;
+	first_line_ += lines;
+
+	if (!decompressor_->next(first_, last_)) {
+		first_ = last_;
+		return false;
+	}
+	position_ = first_;
+	return true;
+}
+
+std::string text_file::location(const char* position) const
+{
+	if (!decompressor_)
+		return detail::text_location(filename_, file_.begin(), position);
+	return detail::text_location(filename_, first_, position, first_line_, first_column_);
+}
+
+} // namespace typa
+} // namespace noma
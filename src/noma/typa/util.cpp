@@ -4,14 +4,15 @@
 
 #include "noma/typa/util.hpp"
 
-#include <algorithm>
+#include "noma/typa/structural_index.hpp"
 
 namespace noma {
 namespace typa {
 
 std::string& remove_whitespace(std::string& str)
 {
-	str.erase(std::remove_if(str.begin(), str.end(), ::isspace), str.end());
+	char* data = &str[0];
+	str.resize(copy_without_whitespace(data, data + str.size(), data) - data);
 	return str;
 }
 
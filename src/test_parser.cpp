@@ -2,17 +2,108 @@
 //
 // See accompanying file LICENSE and README for further information.
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <complex>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <random>
 #include <regex>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "noma/typa/typa.hpp"
 
+#ifdef NOMA_TYPA_GZIP
+	#include <zlib.h>
+#endif
+#ifdef NOMA_TYPA_ZSTD
+	#include <zstd.h>
+#endif
+
 using namespace noma::typa;
 using real_t = double;
 using int_t = int;
 
+/**
+ * Type that only specialises type_to_regexp, to test the regular expression fallback of the scanner.
+ */
+struct colour
+{
+	std::string name;
+	bool operator==(const colour& other) const { return name == other.name; }
+};
+
+std::istream& operator>>(std::istream& in, colour& c) { return in >> c.name; }
+
+namespace noma {
+namespace typa {
+
+template<>
+struct type_to_regexp<colour>
+{
+	static const std::string& exp_str()
+	{
+		static const std::string value { "(?:red|green|blue)" };
+		return value;
+	}
+};
+
+} // namespace typa
+} // namespace noma
+
+/**
+ * Stateful allocator counting its allocations, allocators with different ids are not equal and
+ * do not propagate, to test the storage handling of vector and matrix.
+ */
+template<typename T>
+struct counting_allocator
+{
+	typedef T value_type;
+
+	counting_allocator(size_t* allocations, int id) : allocations(allocations), id(id) { }
+	template<typename U>
+	counting_allocator(const counting_allocator<U>& other) : allocations(other.allocations), id(other.id) { }
+
+	T* allocate(size_t count)
+	{
+		++*allocations;
+		return aligned_allocator<T>().allocate(count);
+	}
+	void deallocate(T* ptr, size_t count) { aligned_allocator<T>().deallocate(ptr, count); }
+
+	bool operator==(const counting_allocator& other) const { return id == other.id; }
+	bool operator!=(const counting_allocator& other) const { return id != other.id; }
+
+	size_t* allocations;
+	int id;
+};
+
+/**
+ * String buffer recording the largest single write, to test that printers write in bounded chunks.
+ */
+struct chunk_recording_buffer : public std::stringbuf
+{
+	size_t largest_write = 0;
+
+protected:
+	std::streamsize xsputn(const char* s, std::streamsize count) override
+	{
+		largest_write = std::max(largest_write, static_cast<size_t>(count));
+		return std::stringbuf::xsputn(s, count);
+	}
+};
+
 template<typename T>
 bool test_match_and_parse_strings(const std::vector<std::string>& strings, const std::string& exp_str, const std::string& type_str = typeid(T).name(), bool expect_failure = false)
 {
@@ -51,6 +142,83 @@ bool test_match_and_parse_strings(const std::vector<std::string>& strings, const
 	return false;
 }
 
+/**
+ * Checks that parse_braced_list<T>() accepts exactly the inputs matched by the regular expression
+ * built from type_to_regexp<T>, which used to be the reference implementation.
+ */
+template<typename T>
+bool test_braced_list_grammar(const std::vector<std::string>& strings, const std::string& type_str)
+{
+	size_t mismatch_count = 0;
+	for (auto& input : strings) {
+		const bool expected = regexp_match<std::vector<T>>(input);
+		// padding makes the input large enough to be parsed with a structural_index
+		const std::string padded_input { input + std::string(structural_index::min_input_size, ' ') };
+		for (auto& variant : { input, padded_input }) {
+			bool parsed = true;
+			try {
+				parse_braced_list<T>(variant);
+			} catch (parser_error&) {
+				parsed = false;
+			}
+			if (parsed != expected) {
+				std::cout << "Grammar mismatch for: '" << input << "' as list of " << type_str << ", expected " << (expected ? "valid" : "invalid") << "." << std::endl;
+				mismatch_count++;
+			}
+		}
+	}
+
+	const bool passed = mismatch_count == 0;
+	std::cout << "List of " << type_str << " grammar test: " << (passed ? "passed." : "failed.") << std::endl;
+	return passed;
+}
+
+template<typename T>
+bool test_parse_result(const std::string& input, const T& expected, const std::string& type_str)
+{
+	bool passed = false;
+	try {
+		passed = string_to_value<T>::parse(input) == expected;
+	} catch (...) {
+	}
+	std::cout << "Parse " << type_str << " from '" << input << "' test: " << (passed ? "passed." : "failed.") << std::endl;
+	return passed;
+}
+
+/**
+ * Message of the parser_error thrown by 'f()', empty if it throws none.
+ */
+template<typename F>
+std::string parser_error_message(F f)
+{
+	try {
+		f();
+	} catch (parser_error& e) {
+		return e.what();
+	}
+	return std::string();
+}
+
+/**
+ * Check that string_to_value<T> converts all 'inputs' exactly like boost::lexical_cast<T>, i.e. to
+ * the same bits or with an exception for the same inputs.
+ */
+template<typename T>
+bool same_as_lexical_cast(const std::vector<std::string>& inputs)
+{
+	bool passed = true;
+	for (const auto& input : inputs) {
+		T value {}, expected {};
+		bool thrown = false, expected_thrown = false;
+		try { value = string_to_value<T>::parse(input); } catch (boost::bad_lexical_cast&) { thrown = true; }
+		try { expected = boost::lexical_cast<T>(input); } catch (boost::bad_lexical_cast&) { expected_thrown = true; }
+		if (thrown != expected_thrown || std::memcmp(&value, &expected, sizeof(T)) != 0) {
+			std::cout << "string_to_value<" << typeid(T).name() << ">(\"" << input << "\") differs from boost::lexical_cast" << std::endl;
+			passed = false;
+		}
+	}
+	return passed;
+}
 
 int main(int argc, char* argv[])
 {
@@ -91,10 +259,1007 @@ int main(int argc, char* argv[])
 	// test complex literals
 
 	// test list
+	const std::vector<std::string> list_inputs {
+		"{1}", "{ 1, -2, +3 }", "{}", "{1,}", "{,1}", "{1 2}", "{1,2", "1,2}", "{1,2}}", "{{1}}", "{1}x",
+		"{1.5, .5, 5., 1e5, 1.e-5, -.5E+5}", "{.}", "{1e}", "{1.e5x}", "{(1,2), 3}", "{(1,2,3)}", "{(1)}",
+		"{a, b c, d-e}", "{a(b)}", "{(a, b)}"
+	};
+	test_braced_list_grammar<int_t>(list_inputs, "int_t");
+	test_braced_list_grammar<real_t>(list_inputs, "real_t");
+	test_braced_list_grammar<std::complex<real_t>>(list_inputs, "complex<real_t>");
+	test_braced_list_grammar<std::string>(list_inputs, "std::string");
+
+	const std::vector<std::string> nested_list_inputs {
+		"{{1},{2,3}}", "{{1}, {2,{3}}}", "{{1},2}", "{{}}", "{{1}{2}}", "{{1},{2}", "{ { 1 , 2 } }"
+	};
+	test_braced_list_grammar<std::vector<int_t>>(nested_list_inputs, "std::vector<int_t>");
+
+	test_parse_result<std::vector<real_t>>("{1.5, -2, 1.e5, .25e-1}", { 1.5, -2.0, 1.e5, .25e-1 }, "std::vector<real_t>");
+	test_parse_result<std::vector<std::complex<real_t>>>("{(1,2), 3}", { { 1.0, 2.0 }, { 3.0, 0.0 } }, "std::vector<complex<real_t>>");
+	test_parse_result<std::vector<std::vector<int_t>>>("{{1, 2}, {3}}", { { 1, 2 }, { 3 } }, "std::vector<std::vector<int_t>>");
+	test_parse_result<std::vector<std::string>>("{ab, c d}", { "ab", "cd" }, "std::vector<std::string>");
+
+	// test whitespace handling and range input
+	{
+		const std::string input { " {\t1 2, ( 3 ,4 ),\n5.\r5 e1 } " };
+		const std::vector<std::complex<real_t>> result = parse_braced_list<std::complex<real_t>>(input.data(), input.data() + input.size());
+		const bool passed = result.size() == 3 && result[0] == 12.0 && result[1] == std::complex<real_t>(3.0, 4.0) && result[2] == 55.0;
+		std::cout << "Whitespace and range input test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test structural index and whitespace removal against trivial implementations, for every
+	// implementation the CPU supports
+	{
+		std::string input;
+		const std::string alphabet { "{}(),1. \t\n\v\f\rx" };
+		for (size_t i = 0; i < 100003; ++i)
+			input += alphabet[(i * 7919 + i / 13) % alphabet.size()];
+
+		std::vector<const char*> expected_positions;
+		std::string expected_no_ws;
+		for (const char* it = input.data(); it != input.data() + input.size(); ++it) {
+			if (std::string("{}(),").find(*it) != std::string::npos)
+				expected_positions.push_back(it);
+			if (!std::isspace(static_cast<unsigned char>(*it)))
+				expected_no_ws += *it;
+		}
+
+		bool passed = remove_whitespace(std::string(input)) == expected_no_ws;
+		std::string names;
+		for (const detail::structural_kernels& kernels : detail::structural_index_kernels()) {
+			std::vector<const char*> positions;
+			kernels.find_structurals(input.data(), input.data() + input.size(), positions);
+			std::string no_ws(input);
+			no_ws.resize(kernels.copy_without_whitespace(input.data(), input.data() + input.size(), &no_ws[0]) - no_ws.data());
+			std::string in_place(input);
+			in_place.resize(kernels.copy_without_whitespace(in_place.data(), in_place.data() + in_place.size(), &in_place[0]) - in_place.data());
+			passed = passed && positions == expected_positions && no_ws == expected_no_ws && in_place == expected_no_ws;
+			names += std::string(names.empty() ? "" : ", ") + kernels.name;
+		}
+		passed = passed && detail::structural_index_kernels().back().name == std::string("scalar");
+		std::cout << "Structural index (" << names << ") test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test numeric conversion against boost::lexical_cast, bit for bit, including the error cases
+	{
+		std::vector<std::string> inputs {
+			"0", "-0", "+7", "1.", ".5", "1.e5", "-.5E+5", "1e", "1.5.5", " 1", "inf", "0x10",
+			"9007199254740993", "1.7976931348623157e308", "1e309", "2.2250738585072011e-308", "4.9e-324", "1e-400",
+			"123456789012345678901234567890", "0.1000000000000000055511151231257827", "3.4028236e38", "1e39",
+			"2147483648", "-2147483648", "-2147483649", "4294967295", "-4294967295", "-4294967296", "000000000000000000000042"
+		};
+		uint64_t state = 42;
+		for (size_t i = 0; i < 10000; ++i) {
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+			std::string input = (state >> 63) ? "-" : "";
+			input += std::to_string(state >> 11);
+			input.insert(1 + (state % input.size()), ".");
+			inputs.push_back(input + "e" + std::to_string(static_cast<int>(state >> 40) % 700 - 350));
+		}
+		const bool passed = same_as_lexical_cast<real_t>(inputs) && same_as_lexical_cast<float>(inputs)
+		                 && same_as_lexical_cast<int_t>(inputs) && same_as_lexical_cast<unsigned>(inputs)
+		                 && same_as_lexical_cast<long long>(inputs) && same_as_lexical_cast<short>(inputs);
+		std::cout << "Numeric conversion test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test long list, used to exhaust the stack of the recursive std::regex implementation
+	{
+		const size_t n = 1000000;
+		std::string input { "{" };
+		for (size_t i = 0; i < n; ++i)
+			input += (i == 0 ? "" : ",") + std::to_string(i % 1000) + ".5";
+		input += "}";
+		const std::vector<real_t> result = parse_braced_list<real_t>(input);
+		const bool passed = result.size() == n && result[n - 1] == 999.5;
+		std::cout << "Long list test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test parallel parsing against the serial parser, including the reported error
+	{
+		const size_t n = 300000;
+		std::string flat { "{" }, nested { "{" }, complex { "{" };
+		for (size_t i = 0; i < n; ++i) {
+			const std::string separator = (i == 0) ? "" : ", ";
+			flat += separator + std::to_string(i) + ".5";
+			nested += separator + "{" + std::to_string(i) + ", " + std::to_string(i % 7) + "}";
+			complex += separator + ((i % 2) ? "(1, " + std::to_string(i) + ")" : std::to_string(i));
+		}
+		flat += "}";
+		nested += "}";
+		complex += "}";
+		std::string malformed = flat;
+		malformed[malformed.size() / 2] = 'x';
+		malformed[malformed.size() - 100] = '{';
+
+		auto error_message = [](const std::string& input) { return parser_error_message([&]() { parse_braced_list<real_t>(input); }); };
+
+		const auto serial_flat = parse_braced_list<real_t>(flat);
+		const auto serial_nested = parse_braced_list<std::vector<int_t>>(nested);
+		const auto serial_complex = parse_braced_list<std::complex<real_t>>(complex);
+		auto matrix_error_message = [](const std::string& input) { return parser_error_message([&]() { string_to_value<matrix<int_t>>::parse(input); }); };
+
+		// a surplus '}' behind the list, which the chunks of the parallel parser take for its end
+		const std::vector<std::string> serial_errors { error_message(malformed), error_message(flat + "}"), error_message(flat + "}}"), matrix_error_message(nested + "}") };
+		set_thread_count(4);
+		const std::vector<std::string> parallel_errors { error_message(malformed), error_message(flat + "}"), error_message(flat + "}}"), matrix_error_message(nested + "}") };
+		bool passed = parse_braced_list<real_t>(flat) == serial_flat
+		           && parse_braced_list<std::vector<int_t>>(nested) == serial_nested
+		           && parse_braced_list<std::complex<real_t>>(complex) == serial_complex
+		           && parallel_errors == serial_errors;
+		set_thread_count(1);
+		for (const std::string& error : serial_errors)
+			passed = passed && !error.empty();
+		std::cout << "Parallel braced list test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test type using the regular expression fallback
+	test_parse_result<std::vector<colour>>("{red, green,blue}", { { "red" }, { "green" }, { "blue" } }, "std::vector<colour>");
+	test_braced_list_grammar<colour>({ "{red}", "{red,green}", "{red,yellow}", "{redgreen}", "{red,}" }, "colour");
+
+	// test pair
+	{
+		const bool passed = parse_pair<int_t, std::string>("(1, abc)") == std::make_pair(1, std::string("abc"))
+		                 && parse_pair<std::vector<int_t>, real_t>("({1,2}, 3.5)") == std::make_pair(std::vector<int_t> { 1, 2 }, 3.5);
+		std::cout << "Pair test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	test_parse_result<std::vector<std::vector<std::complex<real_t>>>>("{{(1,2)}, {3, (4,-5)}}", { { { 1.0, 2.0 } }, { { 3.0, 0.0 }, { 4.0, -5.0 } } }, "std::vector<std::vector<complex<real_t>>>");
+	{
+		const std::vector<pair_wrapper<int_t, std::string>> result = parse_braced_list<pair_wrapper<int_t, std::string>>("{(1,a), (2,b)}");
+		const bool passed = result.size() == 2 && result[1].get() == std::make_pair(2, std::string("b"));
+		std::cout << "List of pair_wrapper test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test std::map and std::unordered_map: parsing, presizing, duplicate keys, nesting, streams
+	{
+		auto error_message = [](const std::string& input) { return parser_error_message([&]() { parse_map<std::unordered_map<std::string, int_t>>(input); }); };
+
+		const std::map<int_t, std::string> ordered = string_to_value<std::map<int_t, std::string>>::parse("{(3, c), (1,a), ( 2 , b )}");
+		const std::unordered_map<std::string, int_t> hashed = parse_map<std::unordered_map<std::string, int_t>>("{(a, 1), (b, 2), (c, 3)}");
+		bool passed = ordered == std::map<int_t, std::string> { { 1, "a" }, { 2, "b" }, { 3, "c" } }
+		              && hashed == std::unordered_map<std::string, int_t> { { "a", 1 }, { "b", 2 }, { "c", 3 } }
+		              && error_message("{(a, 1), (b, 2), (a, 3)}").find("duplicate key 'a' in entry 2") != std::string::npos
+		              && error_message("{(a, 1), (b 2)}").find("malformed input at offset 13") != std::string::npos
+		              && error_message("{}").find("malformed") != std::string::npos;
+
+		const std::string nested_input { "  {(a, {1, 2}), (b, {3})} " };
+		passed = passed && count_list_entries(nested_input.data(), nested_input.data() + nested_input.size()) == 2
+		                && parse_map<std::map<std::string, std::vector<int_t>>>(nested_input).at("a") == std::vector<int_t> { 1, 2 }
+		                && parse_braced_list<std::map<int_t, int_t>>("{{(1, 2)}, {(1, 3), (2, 4)}}")[1].at(2) == 4;
+
+		// large table: buckets sized once from the counted entries
+		std::string large_input { "{" };
+		for (size_t i = 0; i < 100000; ++i)
+			large_input += "(k" + std::to_string(i) + ", " + std::to_string(i) + ")" + ((i + 1 < 100000) ? ", " : "}");
+		const std::unordered_map<std::string, int_t> large = parse_map<std::unordered_map<std::string, int_t>>(large_input);
+		std::unordered_map<std::string, int_t> reserved;
+		reserved.reserve(100000);
+		passed = passed && large.size() == 100000 && large.at("k99999") == 99999 && large.bucket_count() == reserved.bucket_count();
+
+		// print and parse back through the stream operators
+		std::ostringstream out;
+		out << ordered;
+		std::istringstream in(out.str());
+		std::map<int_t, std::string> streamed;
+		in >> streamed;
+		passed = passed && out.str() == "{(1, a), (2, b), (3, c)}" && streamed == ordered;
+		std::cout << "Map test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
 
 	// test vector
+	{
+		vector<real_t> v;
+		std::istringstream("{1.5, 2, -3}") >> v;
+		const bool passed = v.size() == 3 && v.at(0) == 1.5 && v.at(1) == 2.0 && v.at(2) == -3.0;
+		std::cout << "Vector test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test transpose: non-square shape, in place, serial and parallel (large enough for parallel_min_input_size)
+	{
+		bool passed = true;
+		for (size_t threads : { 1, 3 }) {
+			set_thread_count(threads);
+			for (size_t rows : { 70, 400 }) {
+				const size_t cols = (rows * 5) / 6 + 1;
+				matrix<real_t> a(rows, cols), square(rows, rows);
+				for (size_t i = 0; i < rows; ++i) {
+					for (size_t j = 0; j < cols; ++j)
+						a.at(i, j) = i * 1000.0 + j;
+					for (size_t j = 0; j < rows; ++j)
+						square.at(i, j) = i * 1000.0 + j;
+				}
+				const matrix<real_t> t = a.transposed();
+				square.transpose();
+				passed = passed && t.rows() == cols && t.cols() == rows;
+				for (size_t i = 0; i < rows; ++i) {
+					for (size_t j = 0; j < cols; ++j)
+						passed = passed && t.at(j, i) == a.at(i, j);
+					for (size_t j = 0; j < rows; ++j)
+						passed = passed && square.at(j, i) == i * 1000.0 + j;
+				}
+				a.transpose();
+				passed = passed && a.rows() == cols && std::memcmp(a.data(), t.data(), rows * cols * sizeof(real_t)) == 0;
+			}
+		}
+		set_thread_count(1);
+		std::cout << "Matrix transpose test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test streaming operator>>: literals spanning many chunks, a token longer than a chunk, one literal per line
+	{
+		const size_t n = 300000;
+		std::string input { "{" };
+		for (size_t i = 0; i < n; ++i)
+			input += (i == 0 ? "" : ", ") + std::to_string(i) + (i % 3 ? "" : " 0");
+		input += "}\n{" + std::string(3 * stream_scanner::chunk_size, 'x') + ", y}\n{(1,a), (2,b)}\n{1, 2\n{3}";
+		std::istringstream in(input);
+
+		std::vector<long> numbers;
+		vector_wrapper<std::string> strings;
+		vector<pair_wrapper<int_t, std::string>> pairs;
+		std::vector<int_t> after_error;
+		in >> numbers >> strings >> pairs;
+		bool passed = numbers.size() == n && numbers[3] == 30 && numbers[n - 1] == static_cast<long>(n - 1)
+		           && strings.get().size() == 2 && strings.get()[0].size() == 3 * stream_scanner::chunk_size
+		           && pairs.size() == 2 && pairs[1].get() == std::make_pair(2, std::string("b")) && in.good();
+		try {
+			in >> after_error;
+			passed = false;
+		} catch (parser_error&) {
+		}
+		in >> after_error; // the malformed line is skipped
+		passed = passed && after_error == std::vector<int_t> { 3 } && !in.fail();
+		// a conversion that throws in the middle of a line, the rest of the line is skipped as well, even
+		// if it was not read yet
+		std::string overflow_input { "{1, 99999999999" };
+		for (size_t i = 0; i < stream_scanner::chunk_size; ++i)
+			overflow_input += ", 3";
+		std::istringstream overflow(overflow_input + "}\n{4}");
+		try {
+			overflow >> after_error;
+			passed = false;
+		} catch (std::exception&) {
+		}
+		overflow >> after_error;
+		passed = passed && after_error == std::vector<int_t> { 4 };
+		std::cout << "Streaming operator>> test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
 
 	// test matrix
+	{
+		matrix<int_t> m;
+		std::istringstream("{{1, 2, 3}, {4, 5, 6}}") >> m;
+		bool passed = m.rows() == 2 && m.cols() == 3 && m.at(0, 2) == 3 && m.at(1, 0) == 4;
+		try {
+			std::istringstream("{{1, 2}, {3}}") >> m;
+			passed = false;
+		} catch (parser_error&) {
+		}
+		std::cout << "Matrix test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test text file protocol: parallel conversion, element count and error location
+	{
+		const std::string filename { "test_parser_tmp.txt" };
+		auto write_file = [&](const std::string& content) {
+			std::ofstream(filename) << content;
+		};
+		auto error_message = [&]() {
+			return parser_error_message([&]() {
+				matrix<real_t> m;
+				std::istringstream(filename) >> m;
+			});
+		};
+
+		const size_t rows = 500, cols = 300; // more than parallel_min_input_size
+		std::string content = std::to_string(rows) + " " + std::to_string(cols) + "\n";
+		for (size_t i = 0; i < rows; ++i)
+			for (size_t j = 0; j < cols; ++j)
+				content += std::to_string(i) + "." + std::to_string(j) + ((j + 1 < cols) ? "\t" : "\n");
+		write_file(content);
+		set_thread_count(3);
+		matrix<real_t> m;
+		std::istringstream(filename) >> m;
+		set_thread_count(1);
+		bool passed = m.rows() == rows && m.cols() == cols && m.at(0, 0) == 0.0 && m.at(rows - 1, 7) == std::stod(std::to_string(rows - 1) + ".7");
+
+		vector<int_t> v;
+		write_file("3\n 1 2\n3");
+		std::istringstream(filename) >> v;
+		passed = passed && v.size() == 3 && v.at(2) == 3;
+
+		write_file("2 2\n1 2\n3 4x\n");
+		passed = passed && error_message().find("'4x' in 'test_parser_tmp.txt' at line 3, column 3") != std::string::npos;
+		write_file("2 2\n1 2\n3\n");
+		passed = passed && error_message().find("contains 3 elements, expected 4") != std::string::npos;
+
+		std::remove(filename.c_str());
+		std::cout << "Text file protocol test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test .npy round trip via the file protocol, fixtures are generated here
+	{
+		const std::string filename { "test_parser_tmp.npy" };
+		matrix<real_t> m(3, 4);
+		for (size_t i = 0; i < m.rows(); ++i)
+			for (size_t j = 0; j < m.cols(); ++j)
+				m.at(i, j) = i * 10.0 + j + 0.25;
+		m.save_npy(filename);
+		matrix<real_t> loaded;
+		std::istringstream(filename) >> loaded;
+		bool passed = loaded.rows() == 3 && loaded.cols() == 4 && std::memcmp(loaded.data(), m.data(), 12 * sizeof(real_t)) == 0;
+
+		vector<int_t> v(5, 7);
+		v.at(4) = -1;
+		v.save_npy(filename);
+		vector<int_t> loaded_v;
+		std::istringstream(filename) >> loaded_v;
+		passed = passed && loaded_v.size() == 5 && loaded_v.at(0) == 7 && loaded_v.at(4) == -1;
+
+		// wrong element type and dimensions, element type without a .npy representation
+		for (int k = 0; k < 3; ++k) {
+			try {
+				if (k == 0)
+					std::istringstream(filename) >> loaded;
+				else if (k == 1)
+					vector<float>().load_npy(filename);
+				else
+					vector<std::string>().load_npy(filename);
+				passed = false;
+			} catch (parser_error&) {
+			}
+		}
+
+		// Fortran order, written by hand: 2 x 3 matrix {{1, 2, 3}, {4, 5, 6}} stored column by column
+		{
+			std::string header { "{'descr': '" + npy_descr<real_t>::value() + "', 'fortran_order': True, 'shape': (2, 3), }" };
+			header.append(128 - 10 - header.size() - 1, ' ');
+			header += '\n';
+			const real_t column_major[] = { 1, 4, 2, 5, 3, 6 };
+			std::ofstream fs(filename, std::ios::binary);
+			fs.write("\x93NUMPY\x01\x00", 8);
+			fs.put(static_cast<char>(header.size()));
+			fs.put(0);
+			fs << header;
+			fs.write(reinterpret_cast<const char*>(column_major), sizeof(column_major));
+		}
+		loaded.load_npy(filename);
+		passed = passed && loaded.rows() == 2 && loaded.cols() == 3 && loaded.at(0, 2) == 3.0 && loaded.at(1, 0) == 4.0;
+
+		// crafted shape whose element count wraps around to 0 bytes
+		{
+			std::string header { "{'descr': '" + npy_descr<real_t>::value() + "', 'fortran_order': False, 'shape': (4611686018427387904, 4), }" };
+			header.append(128 - 10 - header.size() - 1, ' ');
+			header += '\n';
+			std::ofstream fs(filename, std::ios::binary);
+			fs.write("\x93NUMPY\x01\x00", 8);
+			fs.put(static_cast<char>(header.size()));
+			fs.put(0);
+			fs << header;
+		}
+		passed = passed && parser_error_message([&]() { loaded.load_npy(filename); }).find("too many elements") != std::string::npos;
+
+		std::remove(filename.c_str());
+		std::cout << "NumPy .npy test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test number formatting: exact round trips, notation, fixed precision option and the printers using it
+	{
+		auto format = [](double value) {
+			char buffer[max_number_chars];
+			return std::string(buffer, format_real(value, buffer));
+		};
+		std::mt19937_64 rng(42);
+		bool passed = true;
+		for (size_t i = 0; i < 100000; ++i) {
+			const uint64_t bits = rng();
+			double value;
+			float value_f;
+			std::memcpy(&value, &bits, sizeof(value));
+			std::memcpy(&value_f, &bits, sizeof(value_f));
+			char buffer[max_number_chars];
+			if (std::isfinite(value))
+				passed = passed && string_to_value<double>::parse(format(value)) == value;
+			if (std::isfinite(value_f))
+				passed = passed && string_to_value<float>::parse(std::string(buffer, format_real(value_f, buffer))) == value_f;
+		}
+		passed = passed && format(0.1) == "0.1" && format(-1234.5) == "-1234.5" && format(1e21) == "1e21" && format(1e-7) == "1e-7"
+		                && format(5e-324) == "5e-324" && format(-0.0) == "-0" && format(std::numeric_limits<double>::infinity()) == "inf";
+
+		matrix<real_t> m(2, 2, 0.1);
+		m.at(1, 0) = -3.0;
+		std::ostringstream shortest, scientific;
+		shortest << m;
+		scientific << std::scientific << std::setprecision(2) << m;
+		passed = passed && shortest.str() == "{{0.1,0.1},{-3,0.1}}" && scientific.str() == "{{1.00e-01,1.00e-01},{-3.00e+00,1.00e-01}}";
+		passed = passed && string_to_value<matrix<real_t>>::parse(shortest.str()).at(1, 1) == 0.1;
+		std::ostringstream no_cols;
+		const matrix<real_t> empty_rows(2, 0);
+		no_cols << empty_rows << ' ';
+		empty_rows.print_flat(no_cols);
+		empty_rows.print_raw(no_cols);
+		passed = passed && no_cols.str() == "{{},{}} {}";
+
+		std::ostringstream nested;
+		nested << std::vector<std::vector<int_t>> { { 1, -2 }, { 30 } } << ' ' << pair_wrapper<real_t, std::string>({ 2.5, "x" });
+		passed = passed && nested.str() == "{{1, -2}, {30}} (2.5, x)";
+		std::cout << "Number formatting test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test chunked output of large matrices and vectors, serial and parallel
+	{
+		matrix<real_t> m(1000, 300);
+		vector<real_t> v(300000);
+		for (size_t i = 0; i < m.rows(); ++i)
+			for (size_t j = 0; j < m.cols(); ++j)
+				m.at(i, j) = v[i * m.cols() + j] = i + j * 0.001;
+
+		bool passed = true;
+		std::string serial[3];
+		for (size_t threads : { 1, 3 }) {
+			set_thread_count(threads);
+			chunk_recording_buffer buffers[3];
+			std::ostream print_out(&buffers[0]), raw_out(&buffers[1]), vector_out(&buffers[2]);
+			m.print(print_out);
+			m.print_raw(raw_out, ' ');
+			v.print(vector_out);
+			for (size_t k = 0; k < 3; ++k) {
+				if (threads == 1)
+					serial[k] = buffers[k].str();
+				passed = passed && buffers[k].str() == serial[k] && buffers[k].largest_write < format_chunk_size * max_number_chars;
+			}
+		}
+		set_thread_count(1);
+		const matrix<real_t> parsed = string_to_value<matrix<real_t>>::parse(serial[0]);
+		passed = passed && parsed.at(999, 299) == m.at(999, 299) && serial[0].size() == serial[2].size() + 2 * m.rows()
+		                && std::count(serial[1].begin(), serial[1].end(), '\n') == 1000;
+		std::cout << "Chunked output test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test parsing lists directly into vector and matrix: growth, reuse, padding, errors, serial and parallel
+	{
+		auto error_message = [](const std::string& input) { return parser_error_message([&]() { string_to_value<matrix<int_t>>::parse(input); }); };
+
+		std::string vector_input { "{" }, matrix_input { "{" };
+		for (size_t i = 0; i < 200000; ++i)
+			vector_input += std::to_string(i) + ((i + 1 < 200000) ? ", " : "}");
+		for (size_t i = 0; i < 1000; ++i)
+			matrix_input += "{" + std::to_string(i) + ", 1, 2}" + ((i + 1 < 1000) ? ", " : "}");
+		const std::string large_matrix_input { "{" + std::string(1000000, ' ') + matrix_input.substr(1) };
+
+		bool passed = true;
+		for (size_t threads : { 1, 3 }) {
+			set_thread_count(threads);
+			const vector<int_t> v = string_to_value<vector<int_t>>::parse(vector_input);
+			const matrix<int_t> m = string_to_value<matrix<int_t>>::parse(large_matrix_input);
+			passed = passed && v.size() == 200000 && v.capacity() == v.size() && v[199999] == 199999
+			                && m.rows() == 1000 && m.cols() == 3 && m.at(999, 0) == 999 && m.at(500, 2) == 2;
+			passed = passed && error_message("{" + std::string(1000000, ' ') + "{1, 2}, {3}}").find("differing lengths") != std::string::npos
+			                && error_message("{" + std::string(1000000, ' ') + "{1}, {2, 3}, {x}}").find("malformed input at offset 1000015") != std::string::npos;
+		}
+		set_thread_count(1);
+
+		// streams grow the storage, reuse existing capacity and keep the padded layout
+		vector<int_t> v(300000);
+		std::istringstream vector_in(vector_input);
+		vector_in >> v;
+		matrix<int_t> m;
+		m.set_padded(true);
+		std::istringstream matrix_in(matrix_input);
+		matrix_in >> m;
+		passed = passed && v.size() == 200000 && v.capacity() == 300000 && v[12345] == 12345
+		                && m.rows() == 1000 && m.padded() && m.stride() == matrix<int_t>::padded_stride(3) && m.at(999, 0) == 999 && m.at(0, 2) == 2;
+		std::istringstream uneven_in("{{1}, {2}, {3, 4}}");
+		passed = passed && error_message("{{1,2},{3,4,5}}").find("differing lengths") != std::string::npos
+		                && error_message("{{1,2},{3,4,5},}").find("malformed") != std::string::npos && error_message("{}").find("malformed") != std::string::npos;
+		try {
+			uneven_in >> m;
+			passed = false;
+		} catch (parser_error&) {
+		}
+		std::cout << "Direct list parsing test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test nested lists: single pass parser for all levels, errors, serial and parallel, inputs nested deeper than the type
+	{
+		typedef std::vector<std::vector<std::vector<int_t>>> list3_t;
+		auto is_malformed_at = [](const std::string& input, size_t offset) {
+			return parser_error_message([&]() { parse_braced_list<std::vector<std::vector<int_t>>>(input); }).find("malformed input at offset " + std::to_string(offset) + ",") != std::string::npos;
+		};
+
+		const list3_t expected { { { 1 }, { 2, 3 } }, { { 4, 5, 6 } }, { { 7 }, { 8 }, { 9 } } };
+		bool passed = string_to_value<list3_t>::parse("{ {{1}, {2, 3}}, {{4,5,6}}, {{7},{8},{9}} }") == expected
+		              && parse_braced_list<std::vector<std::vector<std::string>>>("{{{a, b}}, {{c}, {d}}}")[1][1][0] == "d";
+		std::istringstream in("{{{1}, {2, 3}}, {{4, 5, 6}}, {{7}, {8}, {9}}}");
+		list3_t streamed;
+		in >> streamed;
+		passed = passed && streamed == expected;
+
+		// same errors as one braced_list_parser per level, including empty lists
+		passed = passed && is_malformed_at("{{{1}, {}}}", 8) && is_malformed_at("{{{1}, 2}}", 7) && is_malformed_at("{{{1}}, {{2}}", 13)
+		                && is_malformed_at("{{{1}}}}", 7) && is_malformed_at("{{{1}, {2,}}}", 10) && is_malformed_at("{}", 1);
+
+		// nesting deeper than the type fails at the first surplus brace, without recursion
+		const std::string deep = std::string(1000000, '{') + "1" + std::string(1000000, '}');
+		passed = passed && is_malformed_at(deep, 3);
+
+		std::string large_input { "{" };
+		for (size_t i = 0; i < 30000; ++i)
+			large_input += "{{" + std::to_string(i) + ", 1}, {2}}" + ((i + 1 < 30000) ? ", " : "}");
+		for (size_t threads : { 1, 3 }) {
+			set_thread_count(threads);
+			const list3_t large = string_to_value<list3_t>::parse(large_input);
+			passed = passed && large.size() == 30000 && large[29999][0][0] == 29999 && large[12345][1].size() == 1 && large[12345][0].capacity() == 2;
+		}
+		set_thread_count(1);
+		std::cout << "Nested list test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test parser statistics, recorded only with NOMA_TYPA_STATS
+	{
+		std::vector<std::string> names;
+		uint64_t callback_conversions = 0;
+		reset_parse_stats();
+		set_parse_stats_callback([&](const char* name, const parse_stats& call_stats) {
+			names.push_back(name);
+			callback_conversions += call_stats[parse_phase::conversion].calls;
+		});
+		parse_braced_list<real_t>("{1.5, 2, 3}");
+		matrix<real_t> m;
+		std::istringstream("{{1, 2}, {3, 4}}") >> m;
+		parse_pair<int_t, std::string>("(1, a)");
+		set_parse_stats_callback(nullptr);
+		const parse_stats stats = get_parse_stats();
+
+#ifdef NOMA_TYPA_STATS
+		const std::vector<std::string> expected_names { "noma::typa::parse_braced_list()", "noma::typa::matrix<T>::operator>>()", "noma::typa::parse_pair()" };
+		bool passed = names == expected_names && stats.api_calls == 3 && callback_conversions == 9
+		              && stats[parse_phase::conversion].calls == 9 && stats[parse_phase::conversion].bytes == 11
+		              && stats[parse_phase::extraction].calls == 3 && stats[parse_phase::file_io].bytes == 16 && stats.allocations > 0;
+#else
+		bool passed = names.empty() && stats.api_calls == 0 && stats[parse_phase::conversion].calls == 0;
+#endif
+		std::ostringstream table;
+		stats.print(table);
+		passed = passed && table.str().find("conversion") != std::string::npos;
+
+		// the callback may call the library, e.g. to remove itself
+		size_t callback_calls = 0;
+		set_parse_stats_callback([&](const char*, const parse_stats&) {
+			++callback_calls;
+			parse_braced_list<int_t>("{1}");
+			set_parse_stats_callback(nullptr);
+		});
+		parse_braced_list<int_t>("{2}");
+		parse_braced_list<int_t>("{3}");
+#ifdef NOMA_TYPA_STATS
+		passed = passed && callback_calls == 1;
+#else
+		passed = passed && callback_calls == 0;
+#endif
+		std::cout << "Parser statistics test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test allocator support: storage reuse by resize() and assignment, moves, non-trivial elements
+	{
+		typedef matrix<real_t, default_alignment, counting_allocator<real_t>> counted_matrix;
+		size_t allocations = 0;
+		const counting_allocator<real_t> alloc(&allocations, 1);
+		counted_matrix a(4, 5, 1.0, false, alloc), b(4, 5, 2.0, false, alloc);
+		b.resize(2, 3); // shrinking keeps the storage
+		b = a; // same shape, copied into the existing storage
+		bool passed = allocations == 2 && b.at(3, 4) == 1.0 && b.capacity() == 20;
+		counted_matrix c(std::move(a));
+		b = std::move(c);
+		passed = passed && allocations == 2 && a.data() == nullptr && c.rows() == 0 && b.rows() == 4;
+
+		// unequal, non-propagating allocators: elements are moved into the own storage
+		counted_matrix d(1, 1, 0.0, false, counting_allocator<real_t>(&allocations, 2));
+		d = std::move(b);
+		passed = passed && allocations == 4 && d.at(2, 2) == 1.0 && d.get_allocator().id == 2;
+
+		vector<std::string> strings(3, "abc");
+		vector<std::string> other(5, "x");
+		other = strings;
+		const vector<std::string> moved(std::move(other));
+		passed = passed && moved.size() == 3 && moved.at(2) == "abc" && other.size() == 0;
+		std::cout << "Allocator and storage reuse test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test expression templates: fused vector and matrix expressions, scalars, functions, compound assignment, parallel evaluation
+	{
+		vector<real_t> x(5, 2.0), z(5, 3.0);
+		x.at(4) = 4.0;
+		vector<real_t> y = 0.5 * x + z * 2.0 - 1.0;
+		bool passed = y.size() == 5 && y.at(0) == 6.0 && y.at(4) == 7.0;
+		y = sqrt(x * x) / -z + pow(x, 2.0);
+		passed = passed && std::abs(y.at(4) - (4.0 / -3.0 + 16.0)) < 1e-12;
+		y += x;
+		y *= 2.0;
+		passed = passed && std::abs(y.at(0) - 2.0 * (2.0 / -3.0 + 4.0 + 2.0)) < 1e-12;
+
+		matrix<real_t> a(3, 4, 1.0, true), b(3, 4, 2.0);
+		b.at(2, 3) = 5.0;
+		matrix<real_t> c = abs(a - b) * b + exp(a * 0.0);
+		passed = passed && c.rows() == 3 && c.cols() == 4 && c.at(0, 0) == 3.0 && c.at(2, 3) == 21.0;
+		a -= b;
+		passed = passed && a.padded() && a.at(2, 3) == -4.0 && a.at(1, 1) == -1.0;
+
+		vector<std::complex<real_t>> cv(2, std::complex<real_t>(0.0, 1.0));
+		const vector<std::complex<real_t>> cw = cv * cv + 1.0;
+		passed = passed && cw.at(1) == std::complex<real_t>(0.0, 0.0);
+
+		// floating point scalars for integer values are no operands, different shapes are rejected
+		static_assert(is_scalar_operand<int, vector<real_t>>::value && !is_scalar_operand<double, vector<int_t>>::value && is_scalar_operand<double, vector<float>>::value,
+		              "narrowing scalar operand");
+		const vector<float> fv = vector<float>(3, 1.5f) * 2.0;
+		passed = passed && fv.size() == 3 && fv.at(2) == 3.0f;
+		try {
+			y = x + vector<real_t>(4, 1.0);
+			passed = false;
+		} catch (std::invalid_argument&) {
+			passed = passed && y.size() == 5;
+		}
+		try {
+			c += matrix<real_t>(4, 3, 1.0);
+			passed = false;
+		} catch (std::invalid_argument&) {
+			passed = passed && c.at(2, 3) == 21.0;
+		}
+
+		const size_t n = 300000; // more than parallel_min_input_size
+		set_thread_count(3);
+		vector<real_t> large_x(n), large_y(n, 1.0);
+		for (size_t i = 0; i < n; ++i)
+			large_x[i] = static_cast<real_t>(i);
+		large_y = 2.0 * large_x + large_y;
+		matrix<real_t> large_m(n / 100, 100, 1.0);
+		large_m = large_m * 3.0;
+		set_thread_count(1);
+		for (size_t i = 0; i < n; ++i)
+			passed = passed && large_y[i] == 2.0 * i + 1.0;
+		passed = passed && large_m.at(n / 100 - 1, 99) == 3.0;
+		std::cout << "Expression template test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test aligned storage and padded rows through the readers, copy, transposition and .npy output
+	{
+		auto aligned = [](const void* ptr, size_t alignment) { return reinterpret_cast<uintptr_t>(ptr) % alignment == 0; };
+		matrix<real_t> m(5, 9, 1.5, true);
+		bool passed = m.stride() == 16 && aligned(m.data(), 64) && aligned(&m.at(3, 0), 64) && m.at(4, 8) == 1.5;
+		passed = passed && matrix<real_t>::padded_stride(512) == 520 && matrix<real_t>(3, 512).stride() == 512;
+		passed = passed && aligned(matrix<float, 256>(3, 3).data(), 256) && aligned(vector<real_t>(3).data(), 64);
+
+		matrix<real_t> p;
+		p.set_padded(true);
+		std::istringstream("{{1, 2, 3}, {4, 5, 6}}") >> p;
+		passed = passed && p.stride() == 8 && p.at(1, 0) == 4.0 && p.at(1, 2) == 6.0;
+		const matrix<real_t> t = p.transposed();
+		passed = passed && t.padded() && t.stride() == 8 && t.at(2, 1) == 6.0 && t.at(0, 1) == 4.0;
+
+		const std::string filename { "test_parser_tmp.txt" };
+		std::ofstream(filename) << "2 3\n7 8 9\n10 11 12\n";
+		std::istringstream(filename) >> p;
+		passed = passed && p.stride() == 8 && p.at(0, 2) == 9.0 && p.at(1, 0) == 10.0;
+		std::remove(filename.c_str());
+
+		const std::string npy_filename { "test_parser_tmp.npy" };
+		p.save_npy(npy_filename);
+		matrix<real_t> dense;
+		dense.load_npy(npy_filename);
+		passed = passed && dense.stride() == 3 && dense.at(1, 2) == 12.0;
+		matrix<real_t> copy(p);
+		copy.load_npy(npy_filename);
+		passed = passed && copy.padded() && copy.at(1, 1) == 11.0;
+		std::remove(npy_filename.c_str());
+
+		matrix<real_t> square(40, 40, 0.0, true);
+		for (size_t i = 0; i < 40; ++i)
+			for (size_t j = 0; j < 40; ++j)
+				square.at(i, j) = i * 100.0 + j;
+		square.transpose();
+		square.set_padded(false);
+		passed = passed && square.stride() == 40 && square.at(3, 39) == 3903.0 && square.at(39, 3) == 339.0;
+		std::cout << "Aligned and padded matrix test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test sparse matrix: coordinate literal, .mtx input with symmetry, dense conversion, parallel SpMV
+	{
+		const std::string filename { "test_parser_tmp.mtx" };
+		auto error_message = [&]() {
+			return parser_error_message([&]() {
+				sparse_matrix<real_t> m;
+				std::istringstream(filename) >> m;
+			});
+		};
+
+		// unsorted, with a duplicate coordinate that is summed
+		sparse_matrix<real_t> s;
+		std::istringstream("{(3, 4), {(2, 1, 4.5), (0, 0, 1), (0, 3, -2), (2, 0, 3), (0, 0, 1)}}") >> s;
+		bool passed = s.rows() == 3 && s.cols() == 4 && s.nonzeros() == 4 && s.at(0, 0) == 2.0 && s.at(2, 1) == 4.5 && s.at(1, 2) == 0.0
+		              && s.row_offsets() == std::vector<size_t> { 0, 2, 2, 4 } && s.col_indices() == std::vector<size_t> { 0, 3, 0, 1 };
+		std::ostringstream out;
+		out << s;
+		passed = passed && out.str() == "{(3,4),{(0,0,2),(0,3,-2),(2,0,3),(2,1,4.5)}}";
+		const sparse_matrix<real_t> parsed = string_to_value<sparse_matrix<real_t>>::parse(out.str());
+		const matrix<real_t> dense = parsed.to_dense();
+		passed = passed && dense.at(2, 1) == 4.5 && dense.at(1, 1) == 0.0 && sparse_matrix<real_t>(dense).values() == s.values();
+		try {
+			string_to_value<sparse_matrix<real_t>>::parse("{(2, 1), {(0, 0, 1), (-1, 0, 1)}}");
+			passed = false;
+		} catch (parser_error&) {
+		}
+		// the extents are kept for trailing empty rows and columns, and bound the indices
+		std::istringstream("{(5, 6), {(0, 0, 1)}}") >> s;
+		out.str("");
+		out << s;
+		passed = passed && s.rows() == 5 && s.cols() == 6 && out.str() == "{(5,6),{(0,0,1)}}";
+		passed = passed && string_to_value<sparse_matrix<real_t>>::parse(" {(2, 0), {}} ").rows() == 2;
+		std::istringstream("{(2, 3), {}}") >> s;
+		passed = passed && s.rows() == 2 && s.cols() == 3 && s.nonzeros() == 0;
+		std::istringstream("{(5, 6), {(0, 0, 1)}}") >> s;
+		passed = passed && parser_error_message([&]() { std::istringstream("{(2, 2), {(0, 0, 1), (1, 1000000000000, 1)}}") >> s; }).find("entry 1 (1, 1000000000000) is outside of the 2 x 2 matrix") != std::string::npos;
+		try {
+			s.assign(2, 2, { { 0, 0, 1.0 }, { 2, 0, 1.0 } });
+			passed = false;
+		} catch (std::out_of_range&) {
+			passed = passed && s.rows() == 5 && s.nonzeros() == 1;
+		}
+
+		std::ofstream(filename) << "%%MatrixMarket matrix coordinate real symmetric\n% comment\n\n3 3 3\n1 1 2.0\n3 1 -1\n2 2 4e0\n";
+		std::istringstream(filename) >> s;
+		passed = passed && s.nonzeros() == 4 && s.at(0, 2) == -1.0 && s.at(2, 0) == -1.0 && s.at(1, 1) == 4.0;
+		std::ofstream(filename) << "%%MatrixMarket matrix coordinate complex hermitian\n2 2 1\n2 1 1 2\n";
+		sparse_matrix<std::complex<real_t>> c;
+		std::istringstream(filename) >> c;
+		passed = passed && c.at(1, 0) == std::complex<real_t>(1.0, 2.0) && c.at(0, 1) == std::complex<real_t>(1.0, -2.0);
+		std::ofstream(filename) << "%%MatrixMarket matrix coordinate pattern general\n2 3 2\n1 3\n2 1\n";
+		std::istringstream(filename) >> s;
+		passed = passed && s.rows() == 2 && s.cols() == 3 && s.at(0, 2) == 1.0 && s.at(1, 0) == 1.0;
+
+		std::ofstream(filename) << "%%MatrixMarket matrix coordinate real general\n2 2 2\n1 1 1.0\n3 1 2.0\n";
+		passed = passed && error_message().find("invalid entry '3' in 'test_parser_tmp.mtx' at line 4, column 1") != std::string::npos;
+		std::ofstream(filename) << "%%MatrixMarket matrix coordinate real general\n2 2 2\n1 1 1.00000000\n";
+		passed = passed && error_message().find("contains 3 tokens, expected 2 entries of 3") != std::string::npos;
+		std::ofstream(filename) << "%%MatrixMarket matrix coordinate real general\n2 2 1000000000000000\n1 1 1.0\n";
+		passed = passed && error_message().find("declares 1000000000000000 entries, but has room for at most 1") != std::string::npos;
+		std::ofstream(filename) << "%%MatrixMarket matrix array real general\n1 1\n1.0\n";
+		passed = passed && error_message().find("only 'coordinate' is supported") != std::string::npos;
+		std::remove(filename.c_str());
+
+		// banded matrix with more than parallel_min_input_size of nonzeros, serial and parallel products
+		const size_t n = 100000;
+		std::vector<sparse_entry<real_t>> entries;
+		for (size_t i = 0; i < n; ++i)
+			for (size_t j = (i < 2) ? 0 : i - 2; j < std::min(i + 3, n); ++j)
+				entries.push_back({ i, j, 1.0 + (i % 3) });
+		sparse_matrix<real_t> band;
+		band.assign(n, n, entries);
+		const vector<real_t> x(n, 2.0);
+		vector<real_t> y;
+		band.multiply(x, y);
+		set_thread_count(3);
+		const vector<real_t> y_parallel = band.multiply(x);
+		set_thread_count(1);
+		passed = passed && band.nonzeros() == 5 * n - 6 && y.size() == n && y.at(0) == 6.0 && y.at(5) == 30.0 && y.at(n - 1) == 2.0 * 3 * (1 + (n - 1) % 3);
+		for (size_t i = 0; i < n; ++i)
+			passed = passed && y_parallel.at(i) == y.at(i);
+		std::cout << "Sparse matrix test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test tensor: nested lists checked for a rectangular shape, text and .npy files, parallel parsing
+	{
+		auto error_message = [](const std::string& input) { return parser_error_message([&]() { string_to_value<tensor<int_t, 3>>::parse(input); }); };
+
+		tensor<int_t, 3> t;
+		std::istringstream("{{{1, 2}, {3, 4}, {5, 6}}, {{7, 8}, {9, 10}, {11, 12}}}") >> t;
+		bool passed = t.size() == 12 && t.extents() == std::array<size_t, 3> { 2, 3, 2 } && t.strides() == std::array<size_t, 3> { 6, 2, 1 }
+		              && t(0, 1, 1) == 4 && t.at(1, 2, 0) == 11 && t.data()[7] == 8;
+		try {
+			t.at(0, 3, 0);
+			passed = false;
+		} catch (std::out_of_range&) {
+		}
+		std::ostringstream out;
+		out << t;
+		passed = passed && out.str() == "{{{1,2},{3,4},{5,6}},{{7,8},{9,10},{11,12}}}";
+		// no elements, the lists of the leading non-zero extents are kept
+		tensor<int_t, 3> empty;
+		out.str("");
+		empty.resize({ 2, 0, 4 });
+		out << empty << ' ';
+		empty.resize({ 2, 3, 0 });
+		out << empty << ' ';
+		empty.resize({ 0, 3, 4 });
+		out << empty;
+		passed = passed && out.str() == "{{},{}} {{{},{},{}},{{},{},{}}} {}";
+		passed = passed && error_message("{{{1, 2}, {3, 4}}, {{5, 6}, {7}}}").find("differing lengths") != std::string::npos;
+		passed = passed && error_message("{{{1, 2}, {3, 4}}, {{5, 6}}}").find("differing lengths") != std::string::npos;
+		passed = passed && error_message("{{1, 2}, {3, 4}}").find("offset 2") != std::string::npos;
+		const tensor<real_t, 1> line = string_to_value<tensor<real_t, 1>>::parse("{0.5, 1.5}");
+		passed = passed && line.size() == 2 && line(1) == 1.5;
+
+		const std::string filename { "test_parser_tmp.txt" };
+		std::ofstream(filename) << "2 2 1 3\n1 2 3\n4 5 6\n7 8 9\n10 11 12\n";
+		tensor<real_t, 4> q;
+		std::istringstream(filename) >> q;
+		passed = passed && q.size() == 12 && q.extent(3) == 3 && q.at(1, 0, 0, 2) == 9.0 && q.at(1, 1, 0, 0) == 10.0;
+		std::ostringstream raw;
+		q.print_raw(raw, ' ');
+		passed = passed && raw.str() == "1 2 3\n4 5 6\n7 8 9\n10 11 12\n";
+		std::remove(filename.c_str());
+
+		const std::string npy_filename { "test_parser_tmp.npy" };
+		t.save_npy(npy_filename);
+		tensor<int_t, 3> loaded;
+		std::istringstream(npy_filename) >> loaded;
+		passed = passed && loaded.extents() == t.extents() && std::equal(t.data(), t.data() + t.size(), loaded.data());
+		// Fortran order, written by hand: element (i, j, k) is 100 i + 10 j + k
+		{
+			std::string header { "{'descr': '" + npy_descr<real_t>::value() + "', 'fortran_order': True, 'shape': (2, 3, 2), }" };
+			header.append(128 - 10 - header.size() - 1, ' ');
+			header += '\n';
+			real_t column_major[12];
+			for (size_t i = 0; i < 2; ++i)
+				for (size_t j = 0; j < 3; ++j)
+					for (size_t k = 0; k < 2; ++k)
+						column_major[i + 2 * j + 6 * k] = 100 * i + 10 * j + k;
+			std::ofstream fs(npy_filename, std::ios::binary);
+			fs.write("\x93NUMPY\x01\x00", 8);
+			fs.put(static_cast<char>(header.size()));
+			fs.put(0);
+			fs << header;
+			fs.write(reinterpret_cast<const char*>(column_major), sizeof(column_major));
+		}
+		tensor<real_t, 3> fortran;
+		fortran.load_npy(npy_filename);
+		passed = passed && fortran.at(1, 2, 1) == 121.0 && fortran.at(0, 1, 0) == 10.0 && fortran.at(1, 0, 1) == 101.0;
+		passed = passed && parser_error_message([&]() { tensor<std::string, 1>().load_npy(npy_filename); }).find("trivially copyable") != std::string::npos;
+		std::remove(npy_filename.c_str());
+		try {
+			fortran.resize({ size_t(1) << 32, size_t(1) << 32, 2 });
+			passed = false;
+		} catch (std::length_error&) {
+			passed = passed && fortran.size() == 12 && fortran.at(1, 2, 1) == 121.0;
+		}
+		fortran.resize({ 0, size_t(1) << 32, size_t(1) << 32 });
+		passed = passed && fortran.size() == 0;
+
+		// more than parallel_min_input_size of input, parsed in parallel
+		std::string input { "{" };
+		for (size_t i = 0; i < 30000; ++i)
+			input += std::string(i ? "," : "") + "{{" + std::to_string(i) + ",1,2,3,4,5,6,7},{8,9,10,11,12,13,14,15}}";
+		input += "}";
+		set_thread_count(3);
+		const tensor<int_t, 3> large = string_to_value<tensor<int_t, 3>>::parse(input);
+		passed = passed && large.extents() == std::array<size_t, 3> { 30000, 2, 8 } && large(29999, 0, 0) == 29999 && large(1234, 1, 7) == 15;
+		input.replace(input.size() - 6, 3, ""); // drop the last element
+		passed = passed && error_message(input).find("differing lengths") != std::string::npos;
+		set_thread_count(1);
+		std::cout << "Tensor test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test views: owning types convert, rows, columns and blocks refer to the same elements
+	{
+		matrix<real_t> m(3, 4, 0.0, true);
+		for (size_t i = 0; i < m.rows(); ++i)
+			for (size_t j = 0; j < m.cols(); ++j)
+				m.at(i, j) = i * 10.0 + j;
+		const matrix_view<real_t> mv = m;
+		const matrix_view<real_t> b = mv.block(1, 1, 2, 2);
+		bool passed = mv.data() == m.data() && mv.stride() == m.stride() && b.at(1, 0) == 21.0 && b.stride() == m.stride();
+		std::ostringstream out;
+		out << b << ' ' << mv.row(2) << ' ' << mv.col(3).slice(1, 2) << ' ' << mv.block(0, 1, 2, 0);
+		passed = passed && out.str() == "{{11,12},{21,22}} {20,21,22,23} {13,23} {{},{}}";
+		std::ostringstream raw;
+		b.print_raw(raw, ' ');
+		passed = passed && raw.str() == "11 12\n21 22\n";
+
+		b.scale(2.0);
+		mv.col(0).scale(-1.0);
+		passed = passed && m.at(2, 2) == 44.0 && m.at(1, 1) == 22.0 && m.at(1, 3) == 13.0 && m.at(2, 0) == -20.0 && m.at(0, 1) == 1.0;
+		const matrix<real_t> sum = b + 1.0;
+		passed = passed && sum.rows() == 2 && sum.at(1, 1) == 45.0;
+
+		// read-only views of const owners and external buffers
+		const vector<int_t> v(4, 3);
+		const vector_view<const int_t> vv = v;
+		const real_t buffer[] = { 1, 2, 3, 4, 5, 6 };
+		const matrix_view<const real_t> external(buffer, 2, 3);
+		const vector_view<const real_t> column = matrix_view<const real_t>(mv).col(1);
+		passed = passed && vv.size() == 4 && vv[3] == 3 && external.at(1, 0) == 4.0 && external.col(2).at(1) == 6.0 && column.at(2) == 42.0;
+		std::cout << "View test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+
+	// test compressed text files: gzip fixtures are generated here, windows are cut between elements
+#ifdef NOMA_TYPA_GZIP
+	{
+		const std::string filename { "test_parser_tmp.txt.gz" };
+		auto write_gzip = [&](const std::string& contents) {
+			gzFile file = gzopen(filename.c_str(), "wb1");
+			gzwrite(file, contents.data(), static_cast<unsigned>(contents.size()));
+			gzclose(file);
+		};
+		auto error_message = [&]() {
+			return parser_error_message([&]() {
+				vector<int_t> v;
+				std::istringstream(filename) >> v;
+			});
+		};
+
+		write_gzip("2 3\n1 2 3\n4 5 6\n");
+		matrix<real_t> m(1, 1, 0.0, true);
+		std::istringstream(filename) >> m;
+		bool passed = m.rows() == 2 && m.cols() == 3 && m.padded() && m.at(1, 2) == 6.0;
+
+		// more than decompressor::window_size, one element per line
+		const size_t n = 1000000;
+		std::string contents { std::to_string(n) + "\n" };
+		for (size_t i = 0; i < n; ++i)
+			contents += std::to_string(i * 7) + "\n";
+		write_gzip(contents);
+		vector<int_t> v;
+		set_thread_count(3);
+		std::istringstream(filename) >> v;
+		set_thread_count(1);
+		passed = passed && v.size() == n && v.at(0) == 0 && v.at(123456) == 123456 * 7 && v.at(n - 1) == static_cast<int_t>((n - 1) * 7);
+
+		contents.replace(contents.rfind('\n', contents.size() - 2) + 1, 1, "x");
+		write_gzip(contents);
+		const std::string message = error_message();
+		passed = passed && message.find("malformed element 'x") != std::string::npos && message.find("at line " + std::to_string(n + 1) + ", column 1") != std::string::npos;
+		write_gzip("3 1 2");
+		passed = passed && error_message().find("contains 2 elements, expected 3") != std::string::npos;
+
+		// truncated, and a format that is not compiled in
+		write_gzip(contents);
+		std::ifstream in(filename, std::ios::binary);
+		const std::string compressed { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+		std::ofstream(filename, std::ios::binary) << compressed.substr(0, compressed.size() / 2);
+		passed = passed && error_message().find("is truncated") != std::string::npos;
+#ifndef NOMA_TYPA_ZSTD
+		std::ofstream(filename, std::ios::binary) << "\x28\xb5\x2f\xfd";
+		passed = passed && error_message().find("NOMA_TYPA_ZSTD") != std::string::npos;
+#endif
+		std::remove(filename.c_str());
+		std::cout << "Compressed file test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+#endif
+
+	// test zstd compressed text files: several frames, more than one window, truncated in a frame
+#ifdef NOMA_TYPA_ZSTD
+	{
+		const std::string filename { "test_parser_tmp.txt.zst" };
+		auto compress = [](const std::string& contents) {
+			std::string frame(ZSTD_compressBound(contents.size()), '\0');
+			frame.resize(ZSTD_compress(&frame[0], frame.size(), contents.data(), contents.size(), 1));
+			return frame;
+		};
+		auto error_message = [&]() {
+			return parser_error_message([&]() {
+				vector<int_t> v;
+				std::istringstream(filename) >> v;
+			});
+		};
+
+		// the count in one frame, window_size bytes of 8 byte lines in a second one, i.e. more than one
+		// window, with the last block of the second frame decoded across the end of the first window
+		const size_t n = decompressor::window_size / 8;
+		std::string contents;
+		for (size_t i = 0; i < n; ++i)
+			contents += std::to_string(1000000 + i) + "\n";
+		const std::string compressed { compress(contents) };
+		std::ofstream(filename, std::ios::binary) << compress(std::to_string(n) + "\n") << compressed;
+		vector<int_t> v;
+		std::istringstream(filename) >> v;
+		bool passed = v.size() == n && v.at(123456) == 1123456 && v.at(n - 1) == static_cast<int_t>(1000000 + n - 1);
+
+		std::ofstream(filename, std::ios::binary) << compress(std::to_string(n) + "\n") << compressed.substr(0, compressed.size() / 2);
+		passed = passed && error_message().find("is truncated") != std::string::npos;
+		std::remove(filename.c_str());
+		std::cout << "Zstd compressed file test: " << (passed ? "passed." : "failed.") << std::endl;
+	}
+#endif
 
 	return 0;
 }